@@ -0,0 +1,5 @@
+kernel void CopyBuffer(global uint4 const* restrict src, global uint4* restrict dst)
+{
+    size_t const id = get_global_id(0);
+    dst[id] = src[id];
+}
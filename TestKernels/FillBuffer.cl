@@ -0,0 +1,6 @@
+/*the pattern is repeated in whole uint4, so the smaller patterns are replicated into one uint4 by the host*/
+kernel void FillBuffer(global uint4* restrict dst, constant uint4* restrict pattern, uint patternVectors)
+{
+    size_t const id = get_global_id(0);
+    dst[id] = pattern[id % patternVectors];
+}
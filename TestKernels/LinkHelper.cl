@@ -0,0 +1,10 @@
+/*no kernel, only functions: linked into every program by Compilation/BuildPipeline, so the compile-once and link stages are both measured*/
+float Lerp(float a, float b, float t)
+{
+    return mad(t, b - a, a);
+}
+
+size_t LinearGlobalId(void)
+{
+    return (get_global_id(2) * get_global_size(1) + get_global_id(1)) * get_global_size(0) + get_global_id(0);
+}
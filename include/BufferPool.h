@@ -0,0 +1,116 @@
+/*****************************************************************//**
+ * \file   BufferPool.h
+ * \brief  A caching allocator of device buffers with size-class free lists
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <CL/opencl.hpp>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Keeps released cl::Buffer objects of a context for reuse, so allocation on the hot path does not call clCreateBuffer/clReleaseMemObject
+ * @details
+ * A request is rounded up to a size class, 4 classes per power of 2 from 256 bytes, so at most 1/4 of a buffer is wasted.
+ * The released buffers are kept in a free list per (memory flags, size class) until the cached bytes reach the capacity,
+ * then the largest cached buffers are released first. A request larger than the capacity is never cached.
+ * A released buffer is only reused after every command enqueued before its release has completed:
+ * a marker is enqueued into each queue given by setQueues(), and the buffer stays in the free list until all of them have completed.
+ * So every command using a buffer must be enqueued before its last handle is gone, eg. a recorded TaskGraph must be submitted first.
+ * Always create it with std::make_shared, the leases only keep a weak reference to the pool.
+ */
+class BufferPool : public std::enable_shared_from_this<BufferPool>
+{
+public:
+    constexpr static inline size_t defaultCapacity = 256ull * 1024 * 1024;
+    constexpr static inline size_t minSizeClass = 256;
+
+    struct Stats
+    {
+        size_t hits{};          //requests served from a free list
+        size_t misses{};        //requests that called clCreateBuffer
+        size_t evictions{};     //cached buffers released because of the capacity or trim()
+        size_t cachedBuffers{};
+        size_t cachedBytes{};
+    };
+
+    /**
+     * @brief An allocated buffer, which goes back to the pool when the last reference to the lease is gone
+     */
+    struct Lease
+    {
+        cl::Buffer buffer;
+        cl_mem_flags flags;
+        size_t sizeClass;       //0 if the buffer is not cached on release
+        std::weak_ptr<BufferPool> pool;
+
+        Lease(cl::Buffer buffer, cl_mem_flags flags, size_t sizeClass, std::weak_ptr<BufferPool> pool);
+        ~Lease();
+
+        Lease(Lease const&) = delete;
+        Lease& operator=(Lease const&) = delete;
+    };
+
+    explicit BufferPool(cl::Context context, size_t capacity = defaultCapacity);
+
+    /**
+     * @brief Get a buffer of at least [bytes] bytes, from the free list or newly created
+     */
+    [[nodiscard]] std::shared_ptr<Lease> acquire(cl_mem_flags flags, size_t bytes);
+
+    /**
+     * @brief Release the cached buffers until at most [bytes] bytes are cached
+     */
+    void trim(size_t bytes = 0);
+
+    /**
+     * @brief Set the queues whose commands may use the buffers, a released buffer waits for a marker in each of them before it is reused
+     * @details A queue that is finished and no longer used does not have to be kept here
+     */
+    void setQueues(std::vector<cl::CommandQueue> queues);
+
+    /**
+     * @brief Change the maximum cached bytes, 0 disables the caching
+     */
+    void setCapacity(size_t bytes);
+    [[nodiscard]] size_t getCapacity() const;
+
+    [[nodiscard]] Stats getStats() const;
+    void resetStats();
+
+    /**
+     * @brief The number of bytes actually allocated for a request of [bytes]
+     */
+    [[nodiscard]] static size_t sizeClassOf(size_t bytes);
+
+private:
+    using FreeListKey = std::pair<size_t, cl_mem_flags>;    //size class first, so the largest classes are at the end
+
+    /*a released buffer with the markers enqueued at its release*/
+    struct Cached
+    {
+        cl::Buffer buffer;
+        std::vector<cl::Event> fences;
+
+        /*whether every command enqueued before the release has completed, the fences are dropped once they have*/
+        [[nodiscard]] bool completed();
+    };
+
+    cl::Context context;
+    size_t capacity;
+    mutable std::mutex mutex;
+    std::map<FreeListKey, std::vector<Cached>> freeLists;
+    std::vector<cl::CommandQueue> queues;
+    Stats stats;
+
+    void release(cl::Buffer buffer, cl_mem_flags flags, size_t sizeClass);
+
+    /*Requires the lock, the evicted buffers are moved out so they are released after unlocking*/
+    void evictUntil(size_t bytes, std::vector<cl::Buffer>& evicted);
+};
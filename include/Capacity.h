@@ -0,0 +1,80 @@
+/*****************************************************************//**
+ * \file   Capacity.h
+ * \brief  How much memory a device and the host can hold, queried or probed, and the size sweeps derived from it
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <CL/opencl.hpp>
+#include <cstddef>
+#include <vector>
+
+/**
+ * @brief The allocation limits of a device found by ProbeAllocationLimits()
+ */
+struct AllocationLimits
+{
+    size_t largestAllocation{};     //the largest single buffer that could be allocated and filled
+    size_t largestTotal{};          //the most bytes that could be held by live buffers at once
+    bool hostReserveReached{};      //the probe stopped early to keep the host reserve, see DeviceCapacity::hostBudget()
+};
+
+/**
+ * @brief The memory a benchmark may use on the device and on the host
+ * @details
+ * The device limits are CL_DEVICE_MAX_MEM_ALLOC_SIZE and CL_DEVICE_GLOBAL_MEM_SIZE,
+ * replaced by the probed limits once ProbeAllocationLimits() has been run on the device,
+ * because some runtimes allocate more than they report (eg. NVIDIA) and others less.
+ * The host budget is taken when the capacity is queried, so it follows what the other processes use.
+ */
+struct DeviceCapacity
+{
+    size_t maxAllocation{};     //the largest single buffer
+    size_t globalMemory{};      //the most bytes of live buffers
+    bool unifiedMemory{};       //the device allocates from host RAM, eg. CPU and integrated devices
+    bool probed{};              //the device limits come from ProbeAllocationLimits()
+    size_t hostRam{};           //physical RAM of the host
+    size_t hostAvailable{};     //RAM that can still be allocated without swapping
+
+    /**
+     * @brief The host RAM a benchmark may allocate, which keeps 1/8 of the RAM but at least 512MB for everything else
+     */
+    [[nodiscard]] size_t hostBudget() const;
+
+    /**
+     * @brief The largest buffer of a transfer benchmark that keeps [hostCopies] buffers of the same size on the host
+     * @details On a unified memory device the device buffer is taken from the host budget too
+     */
+    [[nodiscard]] size_t transferLimit(size_t hostCopies = 1) const;
+
+    /**
+     * @brief Like transferLimit(), but split over several buffers, so it may exceed the largest single buffer, eg. LargeBuffer
+     */
+    [[nodiscard]] size_t totalLimit(size_t hostCopies = 1) const;
+};
+
+/**
+ * @brief Query the capacity of [device] and of the host now
+ */
+[[nodiscard]] DeviceCapacity GetCapacity(cl::Device const& device);
+
+/**
+ * @brief Find the largest single allocation and the largest total of live allocations on the device of [queue]
+ * @details
+ * Runtimes allocate lazily, so every buffer is filled before it counts.
+ * The largest single buffer is binary searched in steps of [granularity] up to CL_DEVICE_GLOBAL_MEM_SIZE.
+ * The total is then filled with buffers of that size, halving it on failure down to [granularity].
+ * An allocation that would leave less than the host reserve is not attempted on a unified memory device,
+ * so the probe stops before the OOM killer steps in. Every probe buffer is released before returning.
+ * The result is kept for GetCapacity() of the device.
+ */
+AllocationLimits ProbeAllocationLimits(cl::Context const& context, cl::CommandQueue& queue, cl::Device const& device, size_t granularity);
+
+/**
+ * @brief The sizes from [first] up to [limit] on the usual ladder 4kb, 1mb, 32mb, 512mb, then doubling from 1gb
+ * @details [limit] itself is appended, rounded down to 1/8 of a power of 2, when it is well above the last size on the ladder,
+ * so the largest size a device can take is always measured. Empty when [limit] is below [first] or 4kb.
+ */
+[[nodiscard]] std::vector<size_t> SizeSweep(size_t first, size_t limit);
@@ -10,12 +10,66 @@
 #include <string>
 #include <CL/opencl.hpp>
 #include <unordered_map>
+#include <atomic>
+#include <chrono>
 
 
 #ifndef ANDROID
     #include <filesystem>
 #endif
 
+#ifndef ANDROID
+/**
+ * @brief On-disk cache of program binaries, Compiler::build() looks here before compiling from source
+ * @details
+ * An entry is keyed by (source, build options, device name, driver version).
+ * The file name only hashes the first 3, the driver version is stored inside the entry,
+ * so after a driver update the stale entry is removed and rebuilt in place instead of piling up.
+ * Entries are written to a temporary file and then renamed, so a concurrent reader never sees a partial file.
+ * The directory is "kernel_cache" by default, the environment variable CLBENCH_BINARY_CACHE overrides it, and "off" disables it.
+ */
+class BinaryCache
+{
+    std::filesystem::path directory;
+    std::atomic<bool> enabled;
+public:
+    explicit BinaryCache(std::filesystem::path directory);
+
+    /**
+     * @brief Get the directory from CLBENCH_BINARY_CACHE, "kernel_cache" if it is not set and an empty path if it is "off"
+     */
+    static std::filesystem::path directoryFromEnvironment();
+
+    /**
+     * @brief Load the program from the cached binaries of every device
+     * @return The built program, or an empty cl::Program if any device misses
+     */
+    [[nodiscard]] cl::Program load(cl::Context const& context, std::vector<cl::Device> const& devices, std::string const& source, std::string const& options) const;
+
+    /**
+     * @brief Save the binaries of a built program, one entry per device
+     */
+    void store(cl::Program const& program, std::string const& source, std::string const& options) const;
+
+    /**
+     * @brief Remove every entry
+     */
+    void clear() const;
+
+    /**
+     * @brief Turn the cache on or off, e.g. to measure the real compilation time
+     */
+    void setEnabled(bool enable) { enabled.store(enable && !directory.empty(), std::memory_order_relaxed); }
+    [[nodiscard]] bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+    [[nodiscard]] std::filesystem::path const& getDirectory() const { return directory; }
+
+private:
+    [[nodiscard]] std::filesystem::path entryOf(cl::Device const& device, std::string const& source, std::string const& options) const;
+};
+
+extern BinaryCache binaryCache;     //the global program binary cache
+#endif
+
 class Compiler;
 struct CompileOption
 {
@@ -75,6 +129,7 @@ public:
     }
 
     friend class Compiler;
+    friend class KernelCache;
 };
 
 class Compiler
@@ -82,6 +137,18 @@ class Compiler
     cl::Context const& context;
 public:
     Compiler(cl::Context const& context):context{context}{}
+private:
+    /**
+     * @brief Build the source for every device in the context, through the binary cache when it is available
+     * @throw std::runtime_error when the build fails, after the build log is printed
+     */
+    [[nodiscard]] cl::Program buildProgram(std::string const& source, std::string const& options) const;
+
+    /**
+     * @brief Build with essentialFlag + otherFlags, fall back to essentialFlag only if it fails
+     */
+    [[nodiscard]] cl::Program buildProgram(std::string const& source, CompileOption const& essentialFlag, CompileOption const& otherFlags) const;
+public:
 
     [[nodiscard]]std::vector<cl::Kernel> build(const char* kernelName) const;
     [[nodiscard]] std::vector<cl::Kernel> build(const char* kernelName, CompileOption const& essentialFlag, CompileOption const& otherFlags) const;
@@ -92,7 +159,36 @@ public:
     void buildAll() const;
 
 #ifndef ANDROID
-    void buildAll(std::unordered_map<std::string, cl::Kernel>& storage, CompileOption const& essentialFlag, CompileOption const& otherFlags) const;
+    /**
+     * @brief The result of buildAll()
+     */
+    struct BuildStats
+    {
+        size_t programs{};      //programs built successfully
+        size_t failed{};        //sources that failed to compile or link
+        size_t threads{};       //workers used
+        std::chrono::steady_clock::duration compile{};  //wall time of compiling every source and helper to an object
+        std::chrono::steady_clock::duration link{};     //wall time of linking every object and creating the kernels
+        std::chrono::steady_clock::duration total{};
+    };
+
+    /**
+     * @brief Build every .cl file in a directory on a bounded pool of workers
+     * @details
+     * The build is split into 2 stages: every source is compiled to an object (clCompileProgram), then each object is linked (clLinkProgram) with the helper objects.
+     * The helpers are compiled once and linked into every program, so the sources can call the functions they define through a prototype.
+     * The kernels are stored by their function name, only the calling thread writes [storage].
+     * @param directory The directory of the sources, a helper in it is not built as a program of its own
+     * @param helpers The .cl files linked into every program
+     * @param threadCount The number of workers, 0 means the number of hardware threads
+     */
+    BuildStats buildAll(
+        std::unordered_map<std::string, cl::Kernel>& storage,
+        CompileOption const& essentialFlag,
+        CompileOption const& otherFlags,
+        std::filesystem::path const& directory = ".",
+        std::vector<std::filesystem::path> const& helpers = {},
+        size_t threadCount = 0) const;
 #endif
     void buildAll(CompileOption const& essentialFlag) const;
 
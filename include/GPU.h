@@ -8,92 +8,232 @@
 #pragma once
 
 #include <CL/opencl.hpp>
-#include <unordered_map>
+#include <deque>
 #include <string>
 #include <vector>
+#include <iostream>
 #include "Compiler.h"
 #include "MappedBuffer.h"
+#include "BufferPool.h"
+#include "GPUAllocator.h"
+#include "Profiler.h"
+#include "MemoryTracker.h"
 
 enum class Vendor { AMD, NVIDIA, Intel, Qualcomm, Other };
-constexpr static inline auto gpuIndex = 0;
+constexpr static inline auto gpuIndex = 0;  //the selected device is always moved to this slot, see UseDevice()
+constexpr static inline size_t defaultStreamCount = 3;  //enough for overlapping upload, compute and download
+
+/**
+ * @brief Describes which OpenCL device(s) to run on
+ * @details The textual form is a comma separated list of `key:value` pairs, eg. "type:cpu", "vendor:nvidia,index:1" or "name:1660".
+ * Supported keys:
+ *  - type: gpu | cpu | accelerator | all
+ *  - platform: case-insensitive substring of the platform name
+ *  - vendor: case-insensitive substring of the device vendor
+ *  - name: case-insensitive substring of the device name
+ *  - index: index among the devices that match all other keys
+ * A bare number is a shorthand for "index:<number>", and "all" selects every matching device instead of only one.
+ */
+struct DeviceSelector
+{
+    cl_device_type type = CL_DEVICE_TYPE_ALL;
+    std::string platform;
+    std::string vendor;
+    std::string name;
+    size_t index = 0;
+    bool all = false;
+
+    /**
+     * @brief Parse a selector from its textual form
+     */
+    static DeviceSelector parse(std::string const& spec);
+
+    /**
+     * @brief Parse a selector from the CLBENCH_DEVICE environment variable, or return the default selector if it is not set
+     */
+    static DeviceSelector fromEnvironment();
+
+    [[nodiscard]] bool matches(cl::Device const& device) const;
+};
 
 
 struct ComputeDevice:private cl::Device, private cl::Context, private cl::CommandQueue
 {
 private:
 
-    std::unordered_map<std::string, cl::Kernel> kernels;
+    std::deque<cl::CommandQueue> streams;   //the extra in-order queues, stream 0 is the queue this inherits from; a deque, so growing it keeps the references from stream()
+    cl::CommandQueue outOfOrderQueue;       //created on first use
+    std::shared_ptr<BufferPool> bufferPool; //shared, so the buffers still find it after the device is moved
+    std::shared_ptr<Profiler> profiler;     //shared for the same reason
+    std::shared_ptr<MemoryTracker> memoryTracker;   //shared for the same reason
+
+    [[nodiscard]] cl_command_queue_properties queueProperties() const;
 
     template<typename Tuple>
     static void setArgs(cl::Kernel& kernel, Tuple const& args);
 
     auto& getCLDevice() { return static_cast<cl::Device&>(*this); }
     auto& getCLDevice() const { return static_cast<cl::Device const&>(*this); }
+
+    template<typename T>
+    Buffer<T> pooledMalloc(size_t count, AccessMode mode)
+    {
+        auto lease = bufferPool->acquire(GetCLMemFlag(mode), sizeof(T) * count);
+        auto buffer = lease->buffer;
+        return tracked(Buffer<T>{ count, std::move(buffer), std::move(lease), getCLQueue(), mode });
+    }
+
+    /*give the pool every queue of the device, so a released buffer waits for the commands in all of them, see BufferPool*/
+    void updatePoolQueues();
+
+    /*attach the profiler and count the allocation*/
+    template<typename T>
+    Buffer<T> tracked(Buffer<T> buffer)
+    {
+        buffer.m_profiler = profiler;
+        buffer.m_allocation = memoryTracker->track(buffer.getSize());
+        return buffer;
+    }
 public:
     auto& getCLQueue() { return static_cast<cl::CommandQueue&>(*this); }
     auto& getCLContext() { return static_cast<cl::Context&>(*this); }
-    ComputeDevice(cl::Device device);
+    ComputeDevice(cl::Device device, size_t streamCount = defaultStreamCount);
     ~ComputeDevice();
 
+    [[nodiscard]] cl::Device const& getDevice() const { return getCLDevice(); }
+
 
     /**
-     * @brief Block and wait for all the command in the queue to finish
+     * @brief Block and wait for all the command in all the streams to finish
      */
     void finish();
 
+    /**
+     * @brief Get the in-order command queue of a stream
+     * @details Commands in different streams may overlap with each other, eg. an upload in stream 1 with a kernel in stream 0.
+     * Dependencies across streams are expressed with events, by passing the event of one command into the wait list of another.
+     * Stream 0 is the queue used by all the operations that do not specify one.
+     */
+    [[nodiscard]] cl::CommandQueue& stream(size_t index);
+
+    [[nodiscard]] size_t getStreamCount() const { return streams.size() + 1; }
+
+    /**
+     * @brief Change the number of streams, finishing all of them first
+     * @details Adding streams keeps the references returned by stream() valid, removing them invalidates the removed ones
+     * @param count Number of streams, at least 1
+     */
+    void setStreamCount(size_t count);
+
+    /**
+     * @brief Whether the device supports CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE
+     */
+    [[nodiscard]] bool supportsOutOfOrder() const;
+
+    /**
+     * @brief Get the out-of-order queue of the device, which is created on first use
+     * @details Commands in this queue only honor the dependencies given by their wait lists
+     * @throw NotImplementException if the device does not support out-of-order queue
+     */
+    [[nodiscard]] cl::CommandQueue& getOutOfOrderQueue();
+
+    /**
+     * @brief Get the allocator behind malloc(), mallocRead(), mallocWrite() and mallocReadWrite() without initial data
+     * @details The buffers created with host data or extra flags are not pooled, because those flags take effect on creation
+     */
+    [[nodiscard]] BufferPool& getBufferPool() { return *bufferPool; }
+
+    /**
+     * @brief Turn profiling on or off, finishing all the queues first
+     * @details
+     * The queues of the device are recreated with or without CL_QUEUE_PROFILING_ENABLE.
+     * While it is on, enqueueKernel() and the copyFrom(), copyTo(), map() and copy of the buffers allocated by this device record their events into getProfiler().
+     */
+    void setProfiling(bool enable);
+
+    [[nodiscard]] bool isProfiling() const { return profiler->isEnabled(); }
+
+    [[nodiscard]] Profiler& getProfiler() { return *profiler; }
+
+    /**
+     * @brief Get the live and peak bytes of the buffers allocated by this device
+     */
+    [[nodiscard]] MemoryTracker& getMemoryTracker() { return *memoryTracker; }
+
+    /**
+     * @brief The memory of the process, the buffers of this device and the OpenCL objects held by the allocators and the kernel cache
+     */
+    [[nodiscard]] MemoryReport getMemoryReport() const;
+
 
     template<typename T>
     auto mallocRead(size_t count)
     {
-        return Buffer<T>{count, getCLContext(), getCLQueue(), AccessMode::Read};
+        return pooledMalloc<T>(count, AccessMode::Read);
     }
 
     template<typename T>
     auto mallocWrite(size_t count)
     {
-        return Buffer<T>{count, getCLContext(), getCLQueue(), AccessMode::Write};
+        return pooledMalloc<T>(count, AccessMode::Write);
     }
 
     template<typename T>
     auto mallocReadWrite(size_t count)
     {
-        return Buffer<T>{count, getCLContext(), getCLQueue(), AccessMode::ReadWrite};
+        return pooledMalloc<T>(count, AccessMode::ReadWrite);
     }
 
     template<typename T>
     auto mallocRead(size_t count, T const* const data)
     {
-        return Buffer<T>{count, getCLContext(), data, getCLQueue(), AccessMode::Read};
+        return tracked(Buffer<T>{count, getCLContext(), data, getCLQueue(), AccessMode::Read});
     }
 
     template<typename T>
     auto mallocWrite(size_t count, T const* const data)
     {
-        return Buffer<T>{count, getCLContext(), data, getCLQueue(), AccessMode::Write};
+        return tracked(Buffer<T>{count, getCLContext(), data, getCLQueue(), AccessMode::Write});
     }
 
     template<typename T>
     auto mallocReadWrite(size_t count, T const* const data)
     {
-        return Buffer<T>{count, getCLContext(), data, getCLQueue(), AccessMode::ReadWrite};
+        return tracked(Buffer<T>{count, getCLContext(), data, getCLQueue(), AccessMode::ReadWrite});
     }
 
     template<typename T, AccessMode mode>
     auto malloc(size_t count)
     {
-        return Buffer<T>{count, getCLContext(), getCLQueue(), mode};
+        return pooledMalloc<T>(count, mode);
     }
 
     template<typename T, AccessMode mode>
     auto malloc(size_t count, T const* const data)
     {
-        return Buffer<T>{count, getCLContext(), data, getCLQueue(), mode};
+        return tracked(Buffer<T>{count, getCLContext(), data, getCLQueue(), mode});
     }
 
     template<typename T, AccessMode mode>
     auto malloc(size_t count, int extraFlags, T * const data = nullptr)
     {
-        return Buffer<T>{count, getCLContext(), getCLQueue(), mode, extraFlags, data};
+        return tracked(Buffer<T>{count, getCLContext(), getCLQueue(), mode, extraFlags, data});
+    }
+
+    /**
+     * @brief Allocate a buffer in host memory aligned for the device with CL_MEM_USE_HOST_PTR, so the device may use it in place
+     * @details
+     * The host memory is owned by the buffer and freed after every handle to it is gone.
+     * On CPU and integrated devices, map() then returns that host memory without any copy, see Buffer::isZeroCopy().
+     * Discrete devices may still copy it into device memory on use.
+     */
+    template<typename T, AccessMode mode>
+    Buffer<T> mallocZeroCopy(size_t count)
+    {
+        auto const bytes = ZeroCopySize(sizeof(T) * count);
+        std::shared_ptr<void> host{ AlignedAlloc(bytes, ZeroCopyAlignment(getCLDevice())), AlignedDeleter{} };
+        cl::Buffer buffer{ getCLContext(), GetCLMemFlag(mode) | CL_MEM_USE_HOST_PTR, bytes, host.get() };
+        return tracked(Buffer<T>{ count, std::move(buffer), std::move(host), getCLQueue(), mode });
     }
 
 
@@ -114,8 +254,36 @@ public:
         const cl::NDRange& global,
         const cl::NDRange& local = cl::NullRange);
 
+    /**
+     * @brief Enqueue kernel with tuple of kernel arguments into the specified stream
+     * @param queue The stream to enqueue to, see stream()
+     * @param events The events to wait for before the kernel starts, can be nullptr
+     * @param event Receives the event of the kernel, can be nullptr
+     */
+    template<typename Tuple>
+    void enqueueKernel(
+        cl::CommandQueue& queue,
+        cl::Kernel kernel,
+        Tuple&& args,
+        const cl::NDRange& offset,
+        const cl::NDRange& global,
+        const cl::NDRange& local = cl::NullRange,
+        std::vector<cl::Event> const* events = nullptr,
+        cl::Event* event = nullptr);
+
+    /**
+     * @brief Get the calling thread's kernel from [kernelName].cl built with the default flags
+     * @details Same as kernel(kernelName, FastMath, CL2_0), the first kernel in the file is returned
+     */
     cl::Kernel& operator[](const char* kernelName);
 
+    /**
+     * @brief Get the calling thread's kernel from [programName].cl built with the flags, which is compiled only once per device
+     * @param kernelName The kernel function in the program, nullptr means the first kernel in the file
+     * @see KernelCache
+     */
+    cl::Kernel& kernel(const char* programName, CompileOption const& essentialFlag, CompileOption const& otherFlags, const char* kernelName = nullptr);
+
     [[nodiscard]]Vendor getVendor() const;
 
     /*delete all other special member functions */
@@ -126,22 +294,61 @@ public:
 
     friend struct KernelInfo;
     friend class Compiler;
+    friend class TaskGraph;
     template<typename T>
     friend class Buffer;
+    template<typename T>
+    friend class LargeBuffer;
+    template<typename... Args>
+    friend class KernelLaunch;
 };
 
 struct Devices
 {
-    std::vector<ComputeDevice> gpus;    //all gpus on the system
-    std::vector<cl::Device> devices;     //just to satisfy the compiler
+    std::vector<ComputeDevice> gpus;    //all compute devices on the system, gpus first, the selected one at [gpuIndex]
+    std::vector<cl::Device> devices;     //same order as gpus
     cl::Context context;                //a context is consists of multiple gpus
 };
 
 
-extern ComputeDevice& gpu;          //the default gpu
-extern Devices devices;             //all the gpus with context
+extern ComputeDevice& gpu;          //the selected device
+extern Devices devices;             //all the devices with context
 extern Compiler compiler;           //the global compiler
 
+/**
+ * @brief Get all the devices that matches the selector, in discovery order
+ * @details Unless selector.all is set, at most one device (the selector.index-th match) is returned
+ */
+[[nodiscard]] std::vector<cl::Device> FindDevices(DeviceSelector const& selector);
+
+/**
+ * @brief Make [device] the selected device, so that `gpu` and `compiler` refer to it
+ * @details All the queues of the previously selected device are finished first
+ */
+void UseDevice(cl::Device const& device);
+
+/**
+ * @brief Print all the discovered devices with their platforms
+ */
+void ListDevices();
+
+/**
+ * @brief Run [func] once on every device that matches the selector, with the device selected
+ * @return The number of devices [func] has been run on
+ */
+template<typename Func>
+size_t ForEachDevice(DeviceSelector const& selector, Func&& func)
+{
+    auto const selected = FindDevices(selector);
+    for (auto const& device : selected)
+    {
+        UseDevice(device);
+        std::cout << "\n///////////Device: " << device.getInfo<CL_DEVICE_NAME>() << "///////////\n";
+        func();
+    }
+    return selected.size();
+}
+
 
 class Initializer
 {
@@ -192,7 +399,27 @@ template<typename Tuple>
 void ComputeDevice::enqueueKernel(cl::Kernel kernel, Tuple&& args, const cl::NDRange& offset, const cl::NDRange& global, const cl::NDRange& local)
 {
     setArgs(kernel, args);
-    enqueueNDRangeKernel(kernel, offset, global, local);
+    if (!isProfiling())
+        enqueueNDRangeKernel(kernel, offset, global, local);
+    else
+    {
+        cl::Event event;
+        enqueueNDRangeKernel(kernel, offset, global, local, nullptr, &event);
+        profiler->record(event, Profiler::Operation::Kernel, 0, kernel.getInfo<CL_KERNEL_FUNCTION_NAME>(), global, local);
+    }
     flush();
 }
 
+template<typename Tuple>
+void ComputeDevice::enqueueKernel(cl::CommandQueue& queue, cl::Kernel kernel, Tuple&& args, const cl::NDRange& offset, const cl::NDRange& global, const cl::NDRange& local, std::vector<cl::Event> const* events, cl::Event* event)
+{
+    setArgs(kernel, args);
+    cl::Event profiled;
+    if (isProfiling() && event == nullptr)
+        event = &profiled;
+    queue.enqueueNDRangeKernel(kernel, offset, global, local, events, event);
+    if (isProfiling())
+        profiler->record(*event, Profiler::Operation::Kernel, 0, kernel.getInfo<CL_KERNEL_FUNCTION_NAME>(), global, local);
+    queue.flush();
+}
+
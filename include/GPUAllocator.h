@@ -1 +1,153 @@
+/*****************************************************************//**
+ * \file   GPUAllocator.h
+ * \brief  Aligned host memory that a device can use in place with CL_MEM_USE_HOST_PTR
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
 #pragma once
+
+#include <CL/opencl.hpp>
+#include <cstddef>
+#include <memory>
+#include <new>
+#include <string>
+
+/**
+ * @brief The size of a virtual memory page of the host
+ */
+[[nodiscard]] size_t PageSize();
+
+/**
+ * @brief The alignment of host memory needed for [device] to use it in place
+ * @details The larger one of the page size and CL_DEVICE_MEM_BASE_ADDR_ALIGN.
+ * Runtimes silently copy a CL_MEM_USE_HOST_PTR allocation that is not aligned like this, and that is not a multiple of ZeroCopySize().
+ */
+[[nodiscard]] size_t ZeroCopyAlignment(cl::Device const& device);
+
+/**
+ * @brief Round [bytes] up to a whole number of cache lines, which some runtimes (eg. Intel) need for zero-copy
+ */
+[[nodiscard]] constexpr size_t ZeroCopySize(size_t bytes)
+{
+    constexpr size_t cacheLine = 64;
+    return (bytes + cacheLine - 1) / cacheLine * cacheLine;
+}
+
+/**
+ * @brief Allocate [bytes] aligned to [alignment], which must be a power of 2
+ * @throw std::bad_alloc
+ */
+[[nodiscard]] void* AlignedAlloc(size_t bytes, size_t alignment);
+
+/**
+ * @brief Free the memory returned by AlignedAlloc(), nullptr is ignored
+ */
+void AlignedFree(void* ptr) noexcept;
+
+struct AlignedDeleter
+{
+    void operator()(void* ptr) const noexcept { AlignedFree(ptr); }
+};
+
+template<typename T>
+using AlignedPtr = std::unique_ptr<T[], AlignedDeleter>;
+
+/**
+ * @brief Allocate an array of [count] uninitialized [T] aligned to [alignment]
+ */
+template<typename T>
+[[nodiscard]] AlignedPtr<T> MakeAligned(size_t count, size_t alignment)
+{
+    return AlignedPtr<T>{ static_cast<T*>(AlignedAlloc(ZeroCopySize(sizeof(T) * count), alignment)) };
+}
+
+/**
+ * @brief A standard allocator of aligned memory, eg. for a std::vector handed to CL_MEM_USE_HOST_PTR
+ */
+template<typename T>
+class AlignedAllocator
+{
+    size_t m_alignment;
+
+    template<typename U>
+    friend class AlignedAllocator;
+public:
+    using value_type = T;
+
+    explicit AlignedAllocator(size_t alignment = PageSize()) : m_alignment(alignment) {}
+
+    template<typename U>
+    AlignedAllocator(AlignedAllocator<U> const& rhs) noexcept : m_alignment(rhs.m_alignment) {}
+
+    [[nodiscard]] T* allocate(size_t count)
+    {
+        return static_cast<T*>(AlignedAlloc(ZeroCopySize(sizeof(T) * count), m_alignment));
+    }
+
+    void deallocate(T* ptr, size_t) noexcept
+    {
+        AlignedFree(ptr);
+    }
+
+    [[nodiscard]] size_t alignment() const { return m_alignment; }
+
+    template<typename U>
+    bool operator==(AlignedAllocator<U> const& rhs) const noexcept { return m_alignment == rhs.m_alignment; }
+
+    template<typename U>
+    bool operator!=(AlignedAllocator<U> const& rhs) const noexcept { return !(*this == rhs); }
+};
+
+/**
+ * @brief The kind of pages backing a host buffer
+ */
+enum class PageKind
+{
+    Small,          //the default pages, usually 4 KB
+    Transparent,    //transparent huge pages, requested with madvise(MADV_HUGEPAGE) on a 2 MB aligned range, Linux only
+    Huge            //explicit huge pages, mmap(MAP_HUGETLB) on Linux, which needs reserved pages (vm.nr_hugepages), MEM_LARGE_PAGES on Windows
+};
+
+constexpr size_t hugePageSize = 2 * 1024 * 1024;
+
+[[nodiscard]] std::string ToString(PageKind kind);
+
+/**
+ * @brief Parse "small", "thp" or "huge"
+ * @throw ValueError
+ */
+[[nodiscard]] PageKind ParsePageKind(std::string const& kind);
+
+/**
+ * @brief Map [bytes] of page aligned host memory of [kind], whose pages are only allocated when first touched
+ * @throw NotImplementException when the platform has no such pages, std::bad_alloc when none is available
+ */
+[[nodiscard]] void* PageAlloc(size_t bytes, PageKind kind);
+
+/**
+ * @brief Unmap the memory returned by PageAlloc() with the same [bytes] and [kind], nullptr is ignored
+ */
+void PageFree(void* ptr, size_t bytes, PageKind kind) noexcept;
+
+struct PageDeleter
+{
+    size_t bytes{};
+    PageKind kind{};
+    void operator()(void* ptr) const noexcept { PageFree(ptr, bytes, kind); }
+};
+
+template<typename T>
+using PagePtr = std::unique_ptr<T[], PageDeleter>;
+
+/**
+ * @brief Map an array of [count] untouched [T] backed by pages of [kind]
+ */
+template<typename T>
+[[nodiscard]] PagePtr<T> MakePaged(size_t count, PageKind kind)
+{
+    auto const bytes = sizeof(T) * count;
+    return PagePtr<T>{ static_cast<T*>(PageAlloc(bytes, kind)), PageDeleter{ bytes, kind } };
+}
+
+extern PageKind hostPageKind;   //the pages of the host buffers of the transfer benchmarks, set from the command line
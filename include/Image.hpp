@@ -1,6 +1,7 @@
 #pragma once
 #include <random>
 #include <array>
+#include "Rect.h"
 namespace test::Benchmark::Convolution
 {
     static std::mt19937 rdEng{ std::random_device{}() };
@@ -36,6 +37,16 @@ namespace test::Benchmark::Convolution
         [[nodiscard]] auto operator()(size_t row, size_t col, int channel) const { return data[(col + row * columns) * channels + channel-1]; }
 
         [[nodiscard]] auto size() const { return rows * columns * channels; }
+
+        /**
+         * @brief The layout of the image for a rect transfer of the tile starting at pixel ([row], [col]), the channels are interleaved
+         */
+        [[nodiscard]] RectLayout layout(size_t row = 0, size_t col = 0) const { return { col * channels, row, 0, columns * channels }; }
+
+        /**
+         * @brief The extent of a tile of [rows] x [cols] pixels
+         */
+        [[nodiscard]] static RectExtent extent(size_t rows, size_t cols) { return { cols * channels, rows }; }
     };
 
     template<int FS, int channels>
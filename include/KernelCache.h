@@ -0,0 +1,125 @@
+/*****************************************************************//**
+ * \file   KernelCache.h
+ * \brief  Thread-safe cache of built OpenCL programs and per-thread kernels
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <CL/opencl.hpp>
+#include <atomic>
+#include <future>
+#include <map>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include "Compiler.h"
+
+/**
+ * @brief Cache of programs keyed by (program name, essential flags, other flags, device, context)
+ * @details
+ * Each program is compiled once no matter how many threads ask for it at the same time, the others wait for the result.
+ * cl::Kernel::setArg() is not thread-safe on a shared kernel, so every thread gets its own kernel object created from the cached program.
+ * The per-thread kernels are looked up without any lock, the shared program map is only locked (for reading) the first time a thread needs a kernel.
+ */
+class KernelCache
+{
+public:
+    /**
+     * @brief Get the calling thread's kernel, building the program on the first call
+     * @param programName The name of the .cl file without extension
+     * @param kernelName The kernel function in the program, nullptr means the first kernel of the program
+     * @return A kernel owned by the calling thread, valid until the thread exits
+     */
+    cl::Kernel& get(
+        cl::Context const& context,
+        cl::Device const& device,
+        const char* programName,
+        CompileOption const& essentialFlag,
+        CompileOption const& otherFlags,
+        const char* kernelName = nullptr);
+
+    /**
+     * @brief Drop every cached program, the kernels handed out are rebuilt on their next lookup
+     */
+    void clear();
+
+    [[nodiscard]] size_t programCount() const;
+
+    /**
+     * @brief The number of kernels held by all the threads, including the ones left over from before clear()
+     */
+    [[nodiscard]] static size_t kernelCount() { return liveKernels.load(std::memory_order_relaxed); }
+
+private:
+    struct KeyView
+    {
+        KernelCache const* cache;
+        std::string_view program;
+        std::string_view essentialFlag;
+        std::string_view otherFlags;
+        cl_device_id device;
+        cl_context context;
+        std::string_view kernel;
+
+        [[nodiscard]] auto tie() const { return std::tie(cache, program, essentialFlag, otherFlags, device, context, kernel); }
+    };
+
+    struct Key
+    {
+        KernelCache const* cache;
+        std::string program;
+        std::string essentialFlag;
+        std::string otherFlags;
+        cl_device_id device;
+        cl_context context;
+        std::string kernel;
+
+        explicit Key(KeyView const& view);
+        [[nodiscard]] auto tie() const
+        {
+            return std::make_tuple(cache, std::string_view{ program }, std::string_view{ essentialFlag }, std::string_view{ otherFlags }, device, context, std::string_view{ kernel });
+        }
+    };
+
+    struct Less
+    {
+        using is_transparent = void;
+        template<typename Lhs, typename Rhs>
+        bool operator()(Lhs const& lhs, Rhs const& rhs) const { return lhs.tie() < rhs.tie(); }
+    };
+
+    struct Program
+    {
+        cl::Program program;
+        std::string firstKernel;
+    };
+
+    /*counts itself in liveKernels while it exists, the thread kernels live in thread_local maps that can not be walked*/
+    struct KernelCounter
+    {
+        KernelCounter() { liveKernels.fetch_add(1, std::memory_order_relaxed); }
+        KernelCounter(KernelCounter const&) : KernelCounter{} {}
+        KernelCounter& operator=(KernelCounter const&) { return *this; }
+        ~KernelCounter() { liveKernels.fetch_sub(1, std::memory_order_relaxed); }
+    };
+
+    struct ThreadKernel
+    {
+        unsigned long long generation;
+        cl::Kernel kernel;
+        KernelCounter counter{};
+    };
+
+    static inline std::atomic<size_t> liveKernels{};
+
+    mutable std::shared_mutex mutex;
+    std::map<Key, std::shared_future<Program>, Less> programs;
+    std::atomic<unsigned long long> generation{};
+
+    Program getProgram(cl::Context const& context, KeyView const& key, CompileOption const& essentialFlag, CompileOption const& otherFlags);
+};
+
+extern KernelCache kernelCache;     //the global kernel cache
@@ -0,0 +1,145 @@
+/*****************************************************************//**
+ * \file   KernelLaunch.h
+ * \brief  A kernel launch with its arguments and NDRange bound once
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "GPU.h"
+
+/**
+ * @brief A reusable kernel launch
+ * @details
+ * All the arguments are set once on construction, afterwards set<I>() only calls clSetKernelArg when the value really changed,
+ * and enqueue() does not flush, so many launches can be enqueued back to back.
+ * The launch owns a private kernel object created from the same program, so it never fights over arguments with other users of the kernel.
+ * The arguments are the same as ComputeDevice::enqueueKernel(), a std::tuple<size_t, nullptr_t> is local memory.
+ * A launch made for a ComputeDevice records its events into the device's Profiler while the device is profiling, like enqueueKernel() does.
+ */
+template<typename... Args>
+class KernelLaunch
+{
+    cl::Kernel m_kernel;
+    cl::CommandQueue* m_queue;
+    std::tuple<Args...> m_args;
+    cl::NDRange m_offset;
+    cl::NDRange m_global;
+    cl::NDRange m_local;
+    std::shared_ptr<Profiler> m_profiler;   //the profiler of the device, empty when made for a bare queue
+    std::string m_name;                     //the kernel name for the profiler
+
+    [[nodiscard]] bool profiling() const { return m_profiler && m_profiler->isEnabled(); }
+
+    template<typename T>
+    static bool same(T const& lhs, T const& rhs)
+    {
+        if constexpr (std::is_base_of_v<cl::Memory, T>)
+            return lhs() == rhs();
+        else if constexpr (std::is_trivially_copyable_v<T>)
+            return std::memcmp(&lhs, &rhs, sizeof(T)) == 0;
+        else
+            return lhs == rhs;
+    }
+
+    template<size_t... I>
+    void setAll(std::index_sequence<I...>)
+    {
+        (..., ArgSetter{}(static_cast<cl_int>(I), m_kernel, std::get<I>(m_args)));
+    }
+
+public:
+    KernelLaunch(
+        cl::CommandQueue& queue,
+        cl::Kernel const& kernel,
+        std::tuple<Args...> args,
+        const cl::NDRange& offset,
+        const cl::NDRange& global,
+        const cl::NDRange& local = cl::NullRange)
+        : m_kernel{ kernel.getInfo<CL_KERNEL_PROGRAM>(), kernel.getInfo<CL_KERNEL_FUNCTION_NAME>().c_str() },
+        m_queue{ &queue },
+        m_args{ std::move(args) },
+        m_offset{ offset },
+        m_global{ global },
+        m_local{ local }
+    {
+        setAll(std::index_sequence_for<Args...>{});
+    }
+
+    /**
+     * @brief A launch into the default queue of [device], which is profiled with the device
+     */
+    KernelLaunch(
+        ComputeDevice& device,
+        cl::Kernel const& kernel,
+        std::tuple<Args...> args,
+        const cl::NDRange& offset,
+        const cl::NDRange& global,
+        const cl::NDRange& local = cl::NullRange)
+        : KernelLaunch{ device.getCLQueue(), kernel, std::move(args), offset, global, local }
+    {
+        m_profiler = device.profiler;
+        m_name = kernel.getInfo<CL_KERNEL_FUNCTION_NAME>();
+    }
+
+    /**
+     * @brief Change the I-th argument, which is only passed to OpenCL when it differs from the bound one
+     */
+    template<size_t I, typename T>
+    KernelLaunch& set(T&& value)
+    {
+        auto& bound = std::get<I>(m_args);
+        if (!same<std::tuple_element_t<I, std::tuple<Args...>>>(bound, value))
+        {
+            bound = std::forward<T>(value);
+            ArgSetter{}(static_cast<cl_int>(I), m_kernel, bound);
+        }
+        return *this;
+    }
+
+    template<size_t I>
+    [[nodiscard]] auto const& get() const { return std::get<I>(m_args); }
+
+    KernelLaunch& setRange(const cl::NDRange& global, const cl::NDRange& local = cl::NullRange)
+    {
+        m_global = global;
+        m_local = local;
+        return *this;
+    }
+
+    KernelLaunch& setOffset(const cl::NDRange& offset)
+    {
+        m_offset = offset;
+        return *this;
+    }
+
+    /**
+     * @brief Enqueue [times] launches back to back without flushing
+     * @param events The events the first launch waits for, can be nullptr
+     * @param event Receives the event of the last launch, can be nullptr
+     */
+    void enqueue(size_t times = 1, std::vector<cl::Event> const* events = nullptr, cl::Event* event = nullptr)
+    {
+        auto const profiled = profiling();
+        for (size_t i = 0; i < times; ++i)
+        {
+            cl::Event launched;
+            auto* const launchEvent = i + 1 == times && event != nullptr ? event : profiled ? &launched : nullptr;
+            m_queue->enqueueNDRangeKernel(m_kernel, m_offset, m_global, m_local, i == 0 ? events : nullptr, launchEvent);
+            if (profiled)
+                m_profiler->record(*launchEvent, Profiler::Operation::Kernel, 0, m_name, m_global, m_local);
+        }
+    }
+
+    void flush() { m_queue->flush(); }
+
+    [[nodiscard]] cl::Kernel const& getKernel() const { return m_kernel; }
+};
@@ -0,0 +1,145 @@
+/*****************************************************************//**
+ * \file   LargeBuffer.h
+ * \brief  A logical buffer split across several allocations
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include "GPU.h"
+
+/**
+ * @brief A buffer of any size, made of chunks no larger than CL_DEVICE_MAX_MEM_ALLOC_SIZE
+ * @details
+ * copyFrom(), copyTo() and mapChunks() take offsets in the logical range and are split at the chunk boundaries.
+ * Every chunk except the last holds chunkSize() elements, so a kernel can be enqueued once per chunk (see forEachChunk())
+ * with the chunk offset as an argument to recover the logical index.
+ */
+template<typename T>
+class LargeBuffer
+{
+    cl::CommandQueue& m_queue;
+    std::vector<Buffer<T>> m_chunks;
+    size_t m_size;
+    size_t m_chunkSize;
+
+public:
+    using value_type = T;
+
+    /**
+     * @param maxChunkBytes The largest allocation, 0 means CL_DEVICE_MAX_MEM_ALLOC_SIZE of the device
+     */
+    LargeBuffer(ComputeDevice& device, size_t count, AccessMode mode, size_t maxChunkBytes = 0)
+        : m_queue(device.getCLQueue()),
+        m_size(count)
+    {
+        if (maxChunkBytes == 0)
+            maxChunkBytes = static_cast<size_t>(device.getDevice().getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>());
+        m_chunkSize = maxChunkBytes / sizeof(T);
+        if (m_chunkSize > 1024)
+            m_chunkSize -= m_chunkSize % 1024;  //keep the chunks a multiple of any sensible work-group size
+        if (m_chunkSize == 0)
+            throw ValueError{};
+
+        m_chunks.reserve(count / m_chunkSize + 1);
+        for (size_t offset = 0; offset < count; offset += m_chunkSize)
+            m_chunks.push_back(device.tracked(Buffer<T>{ std::min(m_chunkSize, count - offset), device.getCLContext(), device.getCLQueue(), mode }));
+    }
+
+    /**
+     * @brief Number of elements in the logical range
+     */
+    [[nodiscard]] size_t size() const { return m_size; }
+
+    /**
+     * @brief Number of elements in every chunk except the last
+     */
+    [[nodiscard]] size_t chunkSize() const { return m_chunkSize; }
+
+    [[nodiscard]] size_t chunkCount() const { return m_chunks.size(); }
+
+    [[nodiscard]] Buffer<T>& chunk(size_t index) { return m_chunks[index]; }
+    [[nodiscard]] Buffer<T> const& chunk(size_t index) const { return m_chunks[index]; }
+
+    /**
+     * @brief Logical index of the first element of a chunk
+     */
+    [[nodiscard]] size_t chunkOffset(size_t index) const { return index * m_chunkSize; }
+
+    /**
+     * @brief Number of elements in a chunk
+     */
+    [[nodiscard]] size_t chunkLength(size_t index) const { return std::min(m_chunkSize, m_size - chunkOffset(index)); }
+
+    /**
+     * @brief Call func(Buffer<T>& chunk, size_t chunkOffset, size_t chunkLength) for every chunk in order
+     */
+    template<typename Func>
+    void forEachChunk(Func&& func)
+    {
+        for (size_t i = 0; i < m_chunks.size(); ++i)
+            func(m_chunks[i], chunkOffset(i), chunkLength(i));
+    }
+
+    /**
+     * @brief Copy [count] elements from host into the logical range starting at [offset]
+     * @param blocking If true, returns after every part has been copied
+     */
+    LargeBuffer& copyFrom(T const* src, size_t count, bool blocking = false, size_t offset = 0)
+    {
+        forEachPart(offset, count, [&](size_t index, size_t chunkBegin, size_t length, size_t done, bool last)
+        {
+            m_queue.enqueueWriteBuffer(m_chunks[index].getClBuffer(), blocking && last, sizeof(T) * chunkBegin, sizeof(T) * length, src + done);
+        });
+        return *this;
+    }
+
+    /**
+     * @brief Copy [count] elements from the logical range starting at [offset] to host
+     * @param blocking If true, returns after every part has been copied
+     */
+    LargeBuffer& copyTo(T* dst, size_t count, bool blocking = false, size_t offset = 0)
+    {
+        forEachPart(offset, count, [&](size_t index, size_t chunkBegin, size_t length, size_t done, bool last)
+        {
+            m_queue.enqueueReadBuffer(m_chunks[index].getClBuffer(), blocking && last, sizeof(T) * chunkBegin, sizeof(T) * length, dst + done);
+        });
+        return *this;
+    }
+
+    /**
+     * @brief Map [count] elements of the logical range starting at [offset], one mapped region per chunk it covers
+     */
+    template<AccessMode mode>
+    auto mapChunks(size_t offset, size_t count, bool blocking = true)
+    {
+        std::vector<MappedBuffer<T, mode>> mapped;
+        forEachPart(offset, count, [&](size_t index, size_t chunkBegin, size_t length, size_t, bool)
+        {
+            mapped.push_back(m_chunks[index].template map<mode>(chunkBegin, length, blocking));
+        });
+        return mapped;
+    }
+
+private:
+    /*Split [offset, offset + count) at the chunk boundaries, func(chunk index, offset in chunk, length, elements before this part, is last part)*/
+    template<typename Func>
+    void forEachPart(size_t offset, size_t count, Func&& func)
+    {
+        if (offset + count > m_size)
+            throw ValueError{};
+        size_t done{};
+        while (done < count)
+        {
+            auto const position = offset + done;
+            auto const index = position / m_chunkSize;
+            auto const chunkBegin = position - chunkOffset(index);
+            auto const length = std::min(count - done, chunkLength(index) - chunkBegin);
+            func(index, chunkBegin, length, done, done + length == count);
+            done += length;
+        }
+    }
+};
@@ -8,7 +8,13 @@
 #pragma once
 
 #include <CL/opencl.hpp>
+#include <memory>
+#include <utility>
+#include <vector>
 #include "Error.hpp"
+#include "Profiler.h"
+#include "MemoryTracker.h"
+#include "Rect.h"
 
 
 enum class AccessMode
@@ -47,14 +53,24 @@ constexpr cl_mem_flags GetCLMemFlag(AccessMode mode)
     throw InvalidAccessMode{};
 }
 
+/**
+ * @brief A mapped region of a buffer, which is unmapped when it is destroyed or unmap() is called
+ * @details
+ * The region of a non-blocking map is only accessible after the map event has completed, see wait().
+ * It is movable, so a map can be started in one stage of a pipeline and used in another.
+ */
 template<typename T, AccessMode mode>
 class MappedBuffer
 {
-    cl::CommandQueue& m_queue;
-    cl::Buffer const& m_buffer_ref;
+    cl::CommandQueue* m_queue;
+    cl::Buffer m_buffer;
+    size_t m_count;
+    cl::Event m_mapEvent;
+    cl::Event m_unmapEvent;
 public:
     T* m_ptr;
-    MappedBuffer(cl::CommandQueue& queue, T* ptr, cl::Buffer const& buffer_ref):m_queue(queue), m_ptr(ptr), m_buffer_ref(buffer_ref){}
+    MappedBuffer(cl::CommandQueue& queue, T* ptr, cl::Buffer const& buffer, size_t count = 0, cl::Event mapEvent = {})
+        : m_queue(&queue), m_buffer(buffer), m_count(count), m_mapEvent(std::move(mapEvent)), m_ptr(ptr) {}
 
     //template<typename = std::enable_if_t<mode==AccessMode::Write||mode==AccessMode::ReadWrite>>
     operator T* () noexcept { return m_ptr; }
@@ -77,24 +93,121 @@ public:
         return m_ptr[index];
     }
 
+    /**
+     * @brief Number of mapped elements
+     */
+    [[nodiscard]] size_t size() const noexcept { return m_count; }
+
+    [[nodiscard]] bool isMapped() const noexcept { return m_ptr != nullptr; }
+
+    /**
+     * @brief The event of the map command, empty if the map was blocking and the device is not profiling
+     */
+    [[nodiscard]] cl::Event const& getMapEvent() const noexcept { return m_mapEvent; }
+
+    /**
+     * @brief The event of the unmap command, empty before unmap()
+     */
+    [[nodiscard]] cl::Event const& getUnmapEvent() const noexcept { return m_unmapEvent; }
+
+    /**
+     * @brief Block until the region is accessible
+     */
+    MappedBuffer& wait()
+    {
+        if (m_mapEvent() != nullptr)
+            m_mapEvent.wait();
+        return *this;
+    }
+
+    /**
+     * @brief Enqueue the unmap without waiting for it
+     * @param events The events to wait for before unmapping, can be nullptr
+     * @return The event of the unmap command, the device sees the writes after it completes
+     */
+    cl::Event const& unmap(std::vector<cl::Event> const* events = nullptr)
+    {
+        if (isMapped())
+        {
+            m_queue->enqueueUnmapMemObject(m_buffer, m_ptr, events, &m_unmapEvent);
+            m_ptr = nullptr;
+        }
+        return m_unmapEvent;
+    }
+
     ~MappedBuffer()
     {
-        m_queue.enqueueUnmapMemObject(m_buffer_ref, m_ptr);
+        if (isMapped())
+            m_queue->enqueueUnmapMemObject(m_buffer, m_ptr);
+    }
+
+    MappedBuffer(MappedBuffer&& rhs) noexcept
+        : m_queue(rhs.m_queue),
+        m_buffer(std::move(rhs.m_buffer)),
+        m_count(rhs.m_count),
+        m_mapEvent(std::move(rhs.m_mapEvent)),
+        m_unmapEvent(std::move(rhs.m_unmapEvent)),
+        m_ptr(std::exchange(rhs.m_ptr, nullptr))
+    {}
+
+    MappedBuffer& operator=(MappedBuffer&& rhs)
+    {
+        if (this != &rhs)
+        {
+            unmap();
+            m_queue = rhs.m_queue;
+            m_buffer = std::move(rhs.m_buffer);
+            m_count = rhs.m_count;
+            m_mapEvent = std::move(rhs.m_mapEvent);
+            m_unmapEvent = std::move(rhs.m_unmapEvent);
+            m_ptr = std::exchange(rhs.m_ptr, nullptr);
+        }
+        return *this;
     }
 
     /*deleted special member function */
     MappedBuffer(MappedBuffer const&) = delete;
-    MappedBuffer(MappedBuffer&&) = delete;
     MappedBuffer& operator=(MappedBuffer const&) = delete;
-    MappedBuffer& operator=(MappedBuffer&&) = delete;
 };
 
 
+struct ComputeDevice;
+
 template<typename T>
 class Buffer:cl::Buffer
 {
     cl::CommandQueue& m_queue;
     AccessMode m_mode;
+    size_t m_size{};                    //in bytes, a pooled buffer may be larger than that
+    std::shared_ptr<void> m_lease;      //gives the memory back to its allocator when the last handle is gone, see BufferPool
+    std::shared_ptr<Profiler> m_profiler;   //the profiler of the device that allocated it, can be empty
+    std::shared_ptr<MemoryTracker::Allocation> m_allocation;  //counts the memory in the tracker of the device that allocated it, can be empty
+
+    [[nodiscard]] bool profiling() const { return m_profiler && m_profiler->isEnabled(); }
+
+    /*the origin of a rect transfer, in bytes for the row*/
+    static cl::array<size_t, 3> origin(RectLayout const& layout)
+    {
+        return { sizeof(T) * layout.x, layout.y, layout.z };
+    }
+
+    static cl::array<size_t, 3> region(RectExtent const& extent)
+    {
+        return { sizeof(T) * extent.width, extent.height, extent.depth };
+    }
+
+    /**
+     * @brief Another handle to the same device memory, whose operations go to another queue
+     */
+    Buffer(Buffer const& rhs, cl::CommandQueue& queue)
+        :cl::Buffer{rhs.getClBuffer()},
+        m_queue(queue),
+        m_mode(rhs.m_mode),
+        m_size(rhs.m_size),
+        m_lease(rhs.m_lease),
+        m_profiler(rhs.m_profiler),
+        m_allocation(rhs.m_allocation)
+    {}
 public:
     auto& getClBuffer()
     {
@@ -106,11 +219,33 @@ public:
     }
     auto getSize() const
     {
-        return getClBuffer().template getInfo<CL_MEM_SIZE>();
+        return m_size;
+    }
+
+    /**
+     * @brief The host memory given with CL_MEM_USE_HOST_PTR, nullptr otherwise
+     */
+    [[nodiscard]] void* getHostPtr() const
+    {
+        return getClBuffer().template getInfo<CL_MEM_HOST_PTR>();
+    }
+
+    /**
+     * @brief Whether mapping the buffer returns the host memory it was created with, ie. the runtime uses that memory in place instead of copying it
+     */
+    [[nodiscard]] bool isZeroCopy()
+    {
+        auto const host = getHostPtr();
+        if (host == nullptr)
+            return false;
+        auto mapped = map<AccessMode::Read>();
+        return static_cast<void*>(mapped.m_ptr) == host;
     }
 
     using value_type = T;
 
+    friend struct ComputeDevice;
+
     /**
      * Create an empty buffer without allocation
      * 
@@ -125,7 +260,20 @@ public:
     Buffer(size_t size, cl::Context& context, cl::CommandQueue& queue, AccessMode mode)
         : cl::Buffer{ context, GetCLMemFlag(mode), sizeof(T) * size, nullptr },
         m_queue(queue),
-        m_mode(mode)
+        m_mode(mode),
+        m_size(sizeof(T) * size)
+    {}
+
+    /**
+     * @brief Use a buffer handed out by an allocator
+     * @param lease Keeps the allocation, released after every handle to this buffer is gone
+     */
+    Buffer(size_t size, cl::Buffer buffer, std::shared_ptr<void> lease, cl::CommandQueue& queue, AccessMode mode)
+        : cl::Buffer{ std::move(buffer) },
+        m_queue(queue),
+        m_mode(mode),
+        m_size(sizeof(T) * size),
+        m_lease(std::move(lease))
     {}
 
     /**
@@ -134,7 +282,8 @@ public:
     Buffer(size_t size, cl::Context& context, T const* const data, cl::CommandQueue& queue, AccessMode mode)
         : cl::Buffer{ context, GetCLMemFlag(mode) | CL_MEM_COPY_HOST_PTR, sizeof(T) * size, const_cast<T*>(data) },
         m_queue(queue),
-        m_mode(mode)
+        m_mode(mode),
+        m_size(sizeof(T) * size)
     {}
 
 
@@ -145,7 +294,8 @@ public:
     Buffer(size_t size, cl::Context& context, cl::CommandQueue& queue, AccessMode mode, int extraFlags, T* const data = nullptr)
         :cl::Buffer{context, GetCLMemFlag(mode) | extraFlags, sizeof(T)*size, data},
         m_queue(queue),
-        m_mode(mode)
+        m_mode(mode),
+        m_size(sizeof(T) * size)
     {}
 
 
@@ -158,16 +308,48 @@ public:
     //    }
     //}
 
+    ~Buffer()
+    {
+        /*drop this handle before the lease, so the allocator can tell whether anything else still holds the memory*/
+        if (m_lease)
+            cl::Buffer::operator=(cl::Buffer{});
+    }
 
     template<AccessMode mode>
     auto map(bool blocking = true)
     {
-        return MappedBuffer<T, mode>
-        {
-            m_queue,
-            static_cast<T*>(m_queue.enqueueMapBuffer(getClBuffer(), blocking, GetCLMapFlag(mode), 0, getSize())),
-            getClBuffer()
-        };
+        return map<mode>(0, getSize() / sizeof(T), blocking);
+    }
+
+    /**
+     * @brief Map [count] elements from [offset]
+     * @param blocking If false, the region is only accessible after the map event of the result has completed
+     * @param events The events to wait for before mapping, can be nullptr
+     */
+    template<AccessMode mode>
+    auto map(size_t offset, size_t count, bool blocking = true, std::vector<cl::Event> const* events = nullptr)
+    {
+        cl::Event event;
+        auto const ptr = static_cast<T*>(m_queue.enqueueMapBuffer(getClBuffer(), blocking, GetCLMapFlag(mode), sizeof(T) * offset, sizeof(T) * count, events, blocking && !profiling() ? nullptr : &event));
+        if (profiling())
+            m_profiler->record(event, Profiler::Operation::Map, sizeof(T) * count);
+        return MappedBuffer<T, mode>{ m_queue, ptr, getClBuffer(), count, std::move(event) };
+    }
+
+    /**
+     * @brief Start mapping [count] elements from [offset] without blocking, so several maps can be in flight
+     * @details Call wait() on the result, or wait for its map event, before touching the region
+     */
+    template<AccessMode mode>
+    auto mapAsync(size_t offset, size_t count, std::vector<cl::Event> const* events = nullptr)
+    {
+        return map<mode>(offset, count, false, events);
+    }
+
+    template<AccessMode mode>
+    auto mapAsync(std::vector<cl::Event> const* events = nullptr)
+    {
+        return map<mode>(0, getSize() / sizeof(T), false, events);
     }
 
     /*special member functions*/
@@ -177,9 +359,15 @@ public:
     Buffer(Buffer const& rhs, cl::Context& context, cl::CommandQueue& queue)
         :cl::Buffer{context, GetCLMemFlag(rhs.m_mode), rhs.getSize(), nullptr},
         m_queue(queue),
-        m_mode(rhs.m_mode)
+        m_mode(rhs.m_mode),
+        m_size(rhs.m_size),
+        m_profiler(rhs.m_profiler),
+        m_allocation(rhs.m_allocation ? rhs.m_allocation->getTracker().track(rhs.m_size) : nullptr)
     {
-        m_queue.enqueueCopyBuffer(rhs.getClBuffer(), getClBuffer(), 0, 0, rhs.getSize());
+        cl::Event event;
+        m_queue.enqueueCopyBuffer(rhs.getClBuffer(), getClBuffer(), 0, 0, rhs.getSize(), nullptr, profiling() ? &event : nullptr);
+        if (profiling())
+            m_profiler->record(event, Profiler::Operation::Copy, rhs.getSize());
     }
 
 
@@ -195,6 +383,11 @@ public:
     Buffer& operator=(Buffer const& rhs)
     {
         cl::Buffer::operator=(rhs);
+        m_mode = rhs.m_mode;
+        m_size = rhs.m_size;
+        m_lease = rhs.m_lease;
+        m_profiler = rhs.m_profiler;
+        m_allocation = rhs.m_allocation;
         return *this;
     }
     //{
@@ -216,15 +409,142 @@ public:
     //    m_queue.enqueueCopyBuffer(rhs.getClBuffer(), getClBuffer(), 0, 0, rhs.getSize());
     //}
 
-    Buffer& copyFrom(T const* src, size_t count, bool blocking = false)
+    /**
+     * @brief Get a handle to the same buffer which enqueues its operations into [queue] (a stream of the device)
+     * @details The buffer is shared, so synchronize the operations of different streams with events
+     */
+    [[nodiscard]] Buffer on(cl::CommandQueue& queue) const
+    {
+        return Buffer{ *this, queue };
+    }
+
+    /**
+     * @brief Get a view of [count] elements from [offset] with clCreateSubBuffer, which shares the memory of this buffer
+     * @details The offset in bytes must be a multiple of CL_DEVICE_MEM_BASE_ADDR_ALIGN (in bits) of the device, otherwise cl::Error is thrown.
+     * The view keeps the memory of this buffer alive.
+     */
+    [[nodiscard]] Buffer subBuffer(size_t offset, size_t count) const
     {
-        m_queue.enqueueWriteBuffer(getClBuffer(), blocking, 0, sizeof(T) * count, src);
+        cl_buffer_region const region{ sizeof(T) * offset, sizeof(T) * count };
+        cl::Buffer parent{ getClBuffer() };
+        /*0 flags inherit the access of the parent*/
+        Buffer view{ count, parent.createSubBuffer(0, CL_BUFFER_CREATE_TYPE_REGION, &region), m_lease, m_queue, m_mode };
+        view.m_profiler = m_profiler;
+        view.m_allocation = m_allocation;     //the memory of the parent, counted once
+        return view;
+    }
+
+    /**
+     * @param events The events to wait for before the copy starts, can be nullptr
+     * @param event Receives the event of the copy, can be nullptr
+     */
+    Buffer& copyFrom(T const* src, size_t count, bool blocking = false, std::vector<cl::Event> const* events = nullptr, cl::Event* event = nullptr)
+    {
+        cl::Event profiled;
+        if (profiling() && event == nullptr)
+            event = &profiled;
+        m_queue.enqueueWriteBuffer(getClBuffer(), blocking, 0, sizeof(T) * count, src, events, event);
+        if (profiling())
+            m_profiler->record(*event, Profiler::Operation::Write, sizeof(T) * count);
         return *this;
     }
 
-    Buffer& copyTo(T* dst, size_t count, bool blocking = false)
+    /**
+     * @param events The events to wait for before the copy starts, can be nullptr
+     * @param event Receives the event of the copy, can be nullptr
+     */
+    Buffer& copyTo(T* dst, size_t count, bool blocking = false, std::vector<cl::Event> const* events = nullptr, cl::Event* event = nullptr)
+    {
+        cl::Event profiled;
+        if (profiling() && event == nullptr)
+            event = &profiled;
+        m_queue.enqueueReadBuffer(getClBuffer(), blocking, 0, sizeof(T) * count, dst, events, event);
+        if (profiling())
+            m_profiler->record(*event, Profiler::Operation::Read, sizeof(T) * count);
+        return *this;
+    }
+
+    /**
+     * @brief Copy a 2D/3D region of a host array into a region of this buffer with clEnqueueWriteBufferRect, no packing needed on the host
+     * @param host Where the region starts in [src] and the layout of [src]
+     * @param buffer Where the region starts in this buffer and the layout of this buffer, the default is a packed region at the start
+     */
+    Buffer& copyFromRect(T const* src, RectLayout const& host, RectExtent const& extent, RectLayout const& buffer = {}, bool blocking = false, std::vector<cl::Event> const* events = nullptr, cl::Event* event = nullptr)
+    {
+        cl::Event profiled;
+        if (profiling() && event == nullptr)
+            event = &profiled;
+        m_queue.enqueueWriteBufferRect(getClBuffer(), blocking, origin(buffer), origin(host), region(extent),
+            sizeof(T) * buffer.rowPitch, sizeof(T) * buffer.slicePitch, sizeof(T) * host.rowPitch, sizeof(T) * host.slicePitch, src, events, event);
+        if (profiling())
+            m_profiler->record(*event, Profiler::Operation::Write, sizeof(T) * extent.size());
+        return *this;
+    }
+
+    /**
+     * @brief Copy a 2D/3D region of this buffer into a region of a host array with clEnqueueReadBufferRect
+     * @param host Where the region goes in [dst] and the layout of [dst]
+     * @param buffer Where the region starts in this buffer and the layout of this buffer, the default is a packed region at the start
+     */
+    Buffer& copyToRect(T* dst, RectLayout const& host, RectExtent const& extent, RectLayout const& buffer = {}, bool blocking = false, std::vector<cl::Event> const* events = nullptr, cl::Event* event = nullptr)
+    {
+        cl::Event profiled;
+        if (profiling() && event == nullptr)
+            event = &profiled;
+        m_queue.enqueueReadBufferRect(getClBuffer(), blocking, origin(buffer), origin(host), region(extent),
+            sizeof(T) * buffer.rowPitch, sizeof(T) * buffer.slicePitch, sizeof(T) * host.rowPitch, sizeof(T) * host.slicePitch, dst, events, event);
+        if (profiling())
+            m_profiler->record(*event, Profiler::Operation::Read, sizeof(T) * extent.size());
+        return *this;
+    }
+
+    /**
+     * @brief Copy a 2D/3D region of this buffer into a region of [dst] with clEnqueueCopyBufferRect
+     */
+    Buffer& copyRect(Buffer const& dst, RectLayout const& from, RectLayout const& to, RectExtent const& extent, std::vector<cl::Event> const* events = nullptr, cl::Event* event = nullptr)
+    {
+        cl::Event profiled;
+        if (profiling() && event == nullptr)
+            event = &profiled;
+        m_queue.enqueueCopyBufferRect(getClBuffer(), dst.getClBuffer(), origin(from), origin(to), region(extent),
+            sizeof(T) * from.rowPitch, sizeof(T) * from.slicePitch, sizeof(T) * to.rowPitch, sizeof(T) * to.slicePitch, events, event);
+        if (profiling())
+            m_profiler->record(*event, Profiler::Operation::Copy, sizeof(T) * extent.size());
+        return *this;
+    }
+
+    /**
+     * @brief Copy [count] elements from [srcOffset] of this buffer to [dstOffset] of [dst] with clEnqueueCopyBuffer, without going through the host
+     */
+    Buffer& copy(Buffer const& dst, size_t count, size_t srcOffset = 0, size_t dstOffset = 0, std::vector<cl::Event> const* events = nullptr, cl::Event* event = nullptr)
+    {
+        cl::Event profiled;
+        if (profiling() && event == nullptr)
+            event = &profiled;
+        m_queue.enqueueCopyBuffer(getClBuffer(), dst.getClBuffer(), sizeof(T) * srcOffset, sizeof(T) * dstOffset, sizeof(T) * count, events, event);
+        if (profiling())
+            m_profiler->record(*event, Profiler::Operation::Copy, sizeof(T) * count);
+        return *this;
+    }
+
+    /**
+     * @brief Fill [count] elements from [offset] with a repeated [pattern] with clEnqueueFillBuffer
+     * @details
+     * The pattern can be another type than T, of 1, 2, 4, 8, 16, 32, 64 or 128 bytes,
+     * then the offset and the filled bytes must be multiples of its size.
+     * @param count Number of elements, the default fills to the end of the buffer
+     */
+    template<typename Pattern = T>
+    Buffer& fill(Pattern const& pattern, size_t offset = 0, size_t count = static_cast<size_t>(-1), std::vector<cl::Event> const* events = nullptr, cl::Event* event = nullptr)
     {
-        m_queue.enqueueReadBuffer(getClBuffer(), blocking, 0, sizeof(T) * count, dst);
+        if (count == static_cast<size_t>(-1))
+            count = getSize() / sizeof(T) - offset;
+        cl::Event profiled;
+        if (profiling() && event == nullptr)
+            event = &profiled;
+        m_queue.enqueueFillBuffer(getClBuffer(), pattern, sizeof(T) * offset, sizeof(T) * count, events, event);
+        if (profiling())
+            m_profiler->record(*event, Profiler::Operation::Write, sizeof(T) * count);
         return *this;
     }
 
@@ -2,6 +2,7 @@
 #include <iostream>
 #include <algorithm>
 #include <numeric>
+#include "Rect.h"
 
 namespace test::Benchmark::MatrixMultiplication
 {
@@ -54,6 +55,16 @@ namespace test::Benchmark::MatrixMultiplication
         [[nodiscard]]auto size() const { return rows * columns; }
         [[nodiscard]]auto bytes() const { return sizeof(float) * size(); }
 
+        /**
+         * @brief The layout of the matrix for a rect transfer of the tile starting at ([row], [col])
+         */
+        [[nodiscard]] RectLayout layout(size_t row = 0, size_t col = 0) const { return { col, row, 0, columns }; }
+
+        /**
+         * @brief The extent of a tile of [rows] x [cols]
+         */
+        [[nodiscard]] static RectExtent extent(size_t rows, size_t cols) { return { cols, rows }; }
+
         static Matrix make_random_matrix(size_t row, size_t col)
         {
             Matrix m{ row, col };
@@ -0,0 +1,133 @@
+/*****************************************************************//**
+ * \file   Measure.h
+ * \brief  Repeat a benchmark after warming up until its timing is statistically stable
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <ostream>
+#include <type_traits>
+#include <utility>
+#include <vector>
+#include "Timer.hpp"
+
+/**
+ * @brief How long a benchmark is repeated
+ * @details
+ * The warmup iterations are run and thrown away, so the JIT, first-touch page faults and lazy allocations stay out of the samples.
+ * Afterwards the benchmark is repeated until the 95% confidence interval of the mean is within [targetRelativeError] of the mean,
+ * or the [timeBudget] is used up, but always at least [minSamples] and at most [maxSamples] times.
+ */
+struct MeasureOptions
+{
+    size_t warmup = 2;
+    size_t minSamples = 5;
+    size_t maxSamples = 1000;
+    double targetRelativeError = 0.02;
+    std::chrono::duration<double> timeBudget{ 2.0 };    //in seconds, the warmup is not counted
+};
+
+extern MeasureOptions measureOptions;   //the options used by measure() when none is given
+
+/**
+ * @brief The statistics of the samples of a benchmark, all times are in seconds
+ */
+struct Statistics
+{
+    size_t warmup{};
+    size_t samples{};
+    double min{};
+    double median{};
+    double mean{};
+    double p95{};
+    double p99{};
+    double stddev{};
+    double relativeError{};     //half width of the 95% confidence interval of the mean, divided by the mean
+    bool converged{};           //whether relativeError reached the target before the budget ran out
+
+    /**
+     * @brief Compute the statistics from the raw samples
+     * @details The percentiles are linearly interpolated between the sorted samples
+     */
+    static Statistics compute(std::vector<double> samples, size_t warmup = 0);
+
+    /**
+     * @brief Half width of the 95% confidence interval of the mean, using Student's t for small sample counts
+     */
+    static double confidenceHalfWidth(size_t samples, double stddev);
+
+    /**
+     * @brief [amount] processed per second at the median time
+     */
+    [[nodiscard]] long double perSec(long double amount) const { return median > 0 ? amount / median : 0; }
+
+    /**
+     * @brief Print the rate at the median and the best time, followed by the time distribution in microseconds
+     * @param amount The amount processed in one sample, already scaled to the [unit], eg. toMb(bytes)
+     * @param unit The unit of the rate, eg. "MB/s"
+     */
+    void print(std::ostream& os, long double amount, const char* unit) const;
+};
+
+/**
+ * @brief Warm up and repeat [func] until the statistics are stable, see MeasureOptions
+ * @param func The benchmark to repeat.
+ * If it returns a std::chrono::duration, that is taken as the sample, so per-iteration setup can be excluded from the timing,
+ * otherwise the whole call is timed.
+ */
+template<typename Func>
+Statistics measure(Func&& func, MeasureOptions const& options = measureOptions)
+{
+    auto sample = [&func]() -> double
+    {
+        using FpSeconds = std::chrono::duration<double>;
+        if constexpr (std::is_void_v<std::invoke_result_t<Func&>>)
+        {
+            Timer<false> const t;
+            func();
+            return FpSeconds(t.getDuration()).count();
+        }
+        else
+            return std::chrono::duration_cast<FpSeconds>(func()).count();
+    };
+
+    for (size_t i = 0; i < options.warmup; ++i)
+        sample();
+
+    std::vector<double> samples;
+    samples.reserve(options.minSamples);
+    double sum{};
+    double squareSum{};
+    bool converged{};
+    Timer<false> const budget;
+    while (samples.size() < options.maxSamples)
+    {
+        auto const time = sample();
+        samples.push_back(time);
+        sum += time;
+        squareSum += time * time;
+
+        auto const count = samples.size();
+        if (count < options.minSamples)
+            continue;
+
+        auto const mean = sum / count;
+        auto const variance = count > 1 ? std::max(0.0, (squareSum - sum * mean) / (count - 1)) : 0.0;
+        if (count > 1 && Statistics::confidenceHalfWidth(count, std::sqrt(variance)) <= options.targetRelativeError * mean)
+        {
+            converged = true;
+            break;
+        }
+        if (budget.getDuration() >= options.timeBudget)
+            break;
+    }
+
+    auto stats = Statistics::compute(std::move(samples), options.warmup);
+    stats.converged = converged;
+    return stats;
+}
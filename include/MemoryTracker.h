@@ -0,0 +1,89 @@
+/*****************************************************************//**
+ * \file   MemoryTracker.h
+ * \brief  Live and peak bytes of the buffers allocated by a device, and the memory footprint of the process
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <memory>
+#include <ostream>
+
+/**
+ * @brief Counts the Buffer allocations of one ComputeDevice
+ * @details
+ * Every allocation holds an Allocation, which is shared by the handles to the same memory (Buffer::on(), Buffer::subBuffer()),
+ * so an allocation is counted once and until its last handle is gone.
+ * Always create it with std::make_shared, the allocations keep the tracker alive.
+ */
+class MemoryTracker : public std::enable_shared_from_this<MemoryTracker>
+{
+public:
+    struct Stats
+    {
+        size_t liveBuffers{};
+        size_t liveBytes{};
+        size_t peakBytes{};     //the most live bytes since the last resetPeak()
+        size_t allocations{};   //every allocation so far
+    };
+
+    class Allocation
+    {
+        std::shared_ptr<MemoryTracker> tracker;
+        size_t bytes;
+    public:
+        Allocation(std::shared_ptr<MemoryTracker> tracker, size_t bytes);
+        ~Allocation();
+
+        Allocation(Allocation const&) = delete;
+        Allocation& operator=(Allocation const&) = delete;
+
+        [[nodiscard]] MemoryTracker& getTracker() const { return *tracker; }
+        [[nodiscard]] size_t getBytes() const { return bytes; }
+    };
+
+    /**
+     * @brief Count an allocation of [bytes] until the returned object is destroyed
+     */
+    [[nodiscard]] std::shared_ptr<Allocation> track(size_t bytes);
+
+    [[nodiscard]] Stats getStats() const;
+
+    /**
+     * @brief Start the peak over from the bytes live now
+     */
+    void resetPeak();
+
+private:
+    std::atomic<size_t> liveBuffers{};
+    std::atomic<size_t> liveBytes{};
+    std::atomic<size_t> peakBytes{};
+    std::atomic<size_t> allocations{};
+};
+
+/**
+ * @brief The memory of the process and of the selected device at one point, all sizes in bytes
+ * @details
+ * The OpenCL objects are the ones held by this program's allocators and kernel cache,
+ * the runtime has no way to enumerate every live object.
+ */
+struct MemoryReport
+{
+    size_t rss{};               //resident set of the process
+    size_t peakRss{};           //the most resident set since the last ResetPeakRss()
+    size_t deviceBytes{};       //live Buffer allocations of the device
+    size_t devicePeakBytes{};
+    size_t memObjects{};        //cl_mem: the live Buffer allocations plus the ones cached by the BufferPool
+    size_t kernels{};           //cl_kernel created by the kernel cache for all the threads
+    size_t programs{};          //cl_program built by the kernel cache
+
+    void print(std::ostream& os) const;
+};
+
+/**
+ * @brief Start the peak resident set of the process over, where the platform supports it (Linux)
+ */
+void ResetPeakRss();
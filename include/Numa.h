@@ -0,0 +1,84 @@
+/*****************************************************************//**
+ * \file   Numa.h
+ * \brief  NUMA nodes of the host, host memory placed on a node and threads pinned to a node
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <cstddef>
+#include <cstring>
+#include <optional>
+#include <vector>
+#include "GPUAllocator.h"
+
+/**
+ * @brief The online NUMA nodes, {0} on a single-node machine or where the platform does not tell
+ */
+[[nodiscard]] std::vector<size_t> NumaNodes();
+
+/**
+ * @brief The logical cores of [node], empty when unknown
+ */
+[[nodiscard]] std::vector<size_t> NumaNodeCpus(size_t node);
+
+/**
+ * @brief Pins the calling thread to the cores of a NUMA node while it is alive, then restores the previous affinity
+ * @details Nothing is pinned when the platform does not support it or the node has no known core, see isPinned()
+ */
+class NodeAffinity
+{
+public:
+    explicit NodeAffinity(size_t node);
+    ~NodeAffinity();
+
+    NodeAffinity(NodeAffinity const&) = delete;
+    NodeAffinity& operator=(NodeAffinity const&) = delete;
+
+    [[nodiscard]] bool isPinned() const { return pinned; }
+
+private:
+    std::vector<size_t> previous;   //the cores the thread could run on before
+    bool pinned = false;
+};
+
+/**
+ * @brief Map [bytes] of zeroed host memory of [kind] on [node]
+ * @details
+ * The range is bound to the node with mbind() where available, and first touched by a thread pinned to the node,
+ * which places it on that node on the other platforms. Free it with PageFree().
+ * @throw NotImplementException, std::bad_alloc like PageAlloc()
+ */
+[[nodiscard]] void* AllocOnNode(size_t bytes, size_t node, PageKind kind = PageKind::Small);
+
+template<typename T>
+[[nodiscard]] PagePtr<T> MakeOnNode(size_t count, size_t node, PageKind kind = PageKind::Small)
+{
+    auto const bytes = sizeof(T) * count;
+    return PagePtr<T>{ static_cast<T*>(AllocOnNode(bytes, node, kind)), PageDeleter{ bytes, kind } };
+}
+
+/**
+ * @brief Where the transfer benchmarks place their host buffers and their submitting thread, unset means wherever the OS decides
+ */
+struct NumaPlacement
+{
+    std::optional<size_t> bufferNode;
+    std::optional<size_t> threadNode;
+};
+
+extern NumaPlacement numaPlacement;     //set from the command line
+
+/**
+ * @brief Map a zeroed host buffer of [count] elements backed by hostPageKind pages, on numaPlacement.bufferNode when it is set
+ */
+template<typename T>
+[[nodiscard]] PagePtr<T> MakeHostBuffer(size_t count)
+{
+    if (numaPlacement.bufferNode)
+        return MakeOnNode<T>(count, *numaPlacement.bufferNode, hostPageKind);
+    auto buffer = MakePaged<T>(count, hostPageKind);
+    std::memset(buffer.get(), 0, sizeof(T) * count);    //touched like a value-initialized array, so the pages exist before the transfer
+    return buffer;
+}
@@ -0,0 +1,105 @@
+/*****************************************************************//**
+ * \file   Profiler.h
+ * \brief  Records the OpenCL profiling timestamps of the enqueued commands
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <CL/opencl.hpp>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+/**
+ * @brief Collects the events of the commands enqueued while profiling is on, see ComputeDevice::setProfiling()
+ * @details
+ * Recording only keeps the event, the timestamps are read when the records are queried, which waits for the pending commands.
+ * The time of a command is split into:
+ *  - queued -> submit: waiting in the host side queue
+ *  - submit -> start: waiting on the device
+ *  - start -> end: execution
+ */
+class Profiler
+{
+public:
+    enum class Operation { Kernel, Write, Read, Map, Copy };
+
+    struct Record
+    {
+        Operation operation;
+        std::string name;       //the kernel name, empty for the other operations
+        size_t bytes{};         //bytes transferred, 0 for kernels
+        cl::NDRange global;
+        cl::NDRange local;
+        cl_ulong queued{};      //the CL_PROFILING_COMMAND_* timestamps in ns
+        cl_ulong submit{};
+        cl_ulong start{};
+        cl_ulong end{};
+
+        [[nodiscard]] cl_ulong hostQueueTime() const { return submit - queued; }
+        [[nodiscard]] cl_ulong deviceQueueTime() const { return start - submit; }
+        [[nodiscard]] cl_ulong executionTime() const { return end - start; }
+    };
+
+    /**
+     * @brief The records of one operation (and kernel name) added up, all times in ns
+     */
+    struct Summary
+    {
+        size_t count{};
+        size_t bytes{};
+        cl_ulong hostQueueTime{};
+        cl_ulong deviceQueueTime{};
+        cl_ulong executionTime{};
+        cl_ulong minExecutionTime{};
+        cl_ulong maxExecutionTime{};
+    };
+
+    [[nodiscard]] bool isEnabled() const { return enabled.load(std::memory_order_relaxed); }
+
+    /**
+     * @brief Keep the event of a command, does nothing if profiling is off
+     */
+    void record(cl::Event const& event, Operation operation, size_t bytes, std::string name = {}, cl::NDRange const& global = cl::NullRange, cl::NDRange const& local = cl::NullRange);
+
+    /**
+     * @brief Get every record so far, waiting for the pending commands
+     */
+    [[nodiscard]] std::vector<Record> getRecords();
+
+    /**
+     * @brief Get the records added up per operation, keyed by "Kernel <name>", "Write", "Read", "Map" or "Copy"
+     */
+    [[nodiscard]] std::map<std::string, Summary> summarize();
+
+    /**
+     * @brief Print summarize() as a table
+     */
+    void print(std::ostream& os);
+
+    void clear();
+
+    static const char* toString(Operation operation);
+
+private:
+    struct Pending
+    {
+        cl::Event event;
+        Record record;
+    };
+
+    std::atomic<bool> enabled{};
+    std::mutex mutex;
+    std::vector<Pending> pending;
+    std::vector<Record> records;
+
+    void setEnabled(bool enable) { enabled.store(enable, std::memory_order_relaxed); }
+    void resolve();     //requires the lock
+
+    friend struct ComputeDevice;
+};
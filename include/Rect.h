@@ -0,0 +1,35 @@
+/*****************************************************************//**
+ * \file   Rect.h
+ * \brief  Describe a 2D/3D sub-region of a row-major array for the rect transfers
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <cstddef>
+
+/**
+ * @brief Where a region starts in a row-major array, and how the array is laid out, all in elements
+ * @details A pitch of 0 means the array is exactly as wide (or as tall) as the copied region
+ */
+struct RectLayout
+{
+    size_t x{};             //the first element of the region in its row
+    size_t y{};             //the first row
+    size_t z{};             //the first slice
+    size_t rowPitch{};      //elements per row of the whole array
+    size_t slicePitch{};    //elements per slice of the whole array
+};
+
+/**
+ * @brief The size of a copied region, in elements, rows and slices
+ */
+struct RectExtent
+{
+    size_t width{};
+    size_t height = 1;
+    size_t depth = 1;
+
+    [[nodiscard]] size_t size() const { return width * height * depth; }
+};
@@ -0,0 +1,106 @@
+/*****************************************************************//**
+ * \file   Registry.h
+ * \brief  Named benchmarks with their parameter space, selected from the command line
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <functional>
+#include <ostream>
+#include <regex>
+#include <string>
+#include <vector>
+
+/**
+ * @brief The benchmarks known to the program, each one named "<group>/<name>"
+ * @details
+ * A benchmark either takes no parameter, or is swept over a list of sizes (bytes, elements, matrix size...),
+ * which can be replaced from the command line, see Selection.
+ * The optional benchmarks (too slow, or sanity checks) are only run when a filter is given explicitly.
+ */
+class Registry
+{
+public:
+    using Sizes = std::function<std::vector<size_t>()>;     //generates the default parameter space when the benchmark is run
+
+    struct Entry
+    {
+        std::string group;
+        std::string name;
+        std::string parameter;          //what the sizes mean, eg. "bytes", empty when the benchmark takes no parameter
+        Sizes sizes;                    //the default parameter space, generated for the selected device
+        std::function<void(size_t)> run;
+        bool optional{};
+
+        [[nodiscard]] std::string fullName() const { return group + '/' + name; }
+        [[nodiscard]] bool parameterized() const { return !parameter.empty(); }
+    };
+
+    struct Selection
+    {
+        std::regex filter{ "" };        //searched in the full name, the default matches everything
+        bool includeOptional{};         //also run the optional benchmarks, set when the filter comes from the user
+        std::vector<size_t> sizes;      //replaces the sizes of every parameterized benchmark when not empty
+
+        /**
+         * @brief Select the benchmarks of one group, without the optional ones
+         */
+        static Selection group(std::string const& group);
+    };
+
+    /**
+     * @brief Register a benchmark swept over [sizes]
+     */
+    Registry& add(std::string group, std::string name, std::string parameter, std::vector<size_t> sizes, std::function<void(size_t)> run, bool optional = false);
+
+    /**
+     * @brief Register a benchmark swept over the sizes generated by [sizes] right before it is run
+     * @details So the sizes follow the capacity of the selected device, see SizeSweep()
+     */
+    Registry& add(std::string group, std::string name, std::string parameter, Sizes sizes, std::function<void(size_t)> run, bool optional = false);
+
+    /**
+     * @brief Register a benchmark without parameter
+     */
+    Registry& add(std::string group, std::string name, std::function<void()> run, bool optional = false);
+
+    [[nodiscard]] std::vector<Entry const*> select(Selection const& selection) const;
+
+    /**
+     * @brief Run the selected benchmarks in registration order
+     * @details
+     * The device is finished before every run. When a size fails, the larger sizes of the same benchmark are skipped,
+     * because they usually fail for the same reason (eg. exceeding CL_DEVICE_MAX_MEM_ALLOC_SIZE).
+     * After every run the memory report of the device is printed, its peaks are started over before the run.
+     * @return The number of benchmarks run
+     */
+    size_t run(Selection const& selection) const;
+
+    /**
+     * @brief Print the selected benchmarks with their parameter space on the selected device
+     */
+    void list(std::ostream& os, Selection const& selection) const;
+
+    [[nodiscard]] std::vector<Entry> const& getEntries() const { return entries; }
+
+    /**
+     * @brief Parse a comma separated list of sizes
+     * @details
+     * Each item is a number with an optional kb/mb/gb suffix (case insensitive), or a range:
+     *  - "1mb..1gb": doubling from 1mb up to 1gb
+     *  - "1mb..1gb*4": multiplied by 4 each step
+     *  - "128..2048+128": adding 128 each step
+     * @throw ValueError when an item can not be parsed
+     */
+    static std::vector<size_t> parseSizes(std::string const& spec);
+
+    /**
+     * @brief Format a size with the largest kb/mb/gb suffix that divides it
+     */
+    static std::string formatSize(size_t size);
+
+private:
+    std::vector<Entry> entries;
+};
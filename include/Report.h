@@ -0,0 +1,129 @@
+/*****************************************************************//**
+ * \file   Report.h
+ * \brief  Structured benchmark results written as JSON Lines / CSV, and compared against a baseline
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <fstream>
+#include <functional>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "Measure.h"
+#include "MemoryTracker.h"
+
+/**
+ * @brief Collects one record per result of a (benchmark, parameter, device)
+ * @details
+ * The benchmark, parameter and device are set by Registry::run() before each run, the benchmarks only report their values.
+ * A benchmark that reports several results in one run tells them apart with a variant, eg. the filter size of a convolution.
+ * The records are appended to the output files as soon as they are reported, so a crash keeps the results so far.
+ * All the values are rates, so a higher value is better.
+ * Every record also carries the memory report at the time it was reported, see setMemorySource().
+ */
+class Reporter
+{
+public:
+    struct Record
+    {
+        std::string benchmark;      //"<group>/<name>"
+        std::string parameter;      //what size means, eg. "bytes", empty when the benchmark takes no parameter
+        size_t size{};
+        std::string variant;
+        std::string device;
+        std::string unit;
+        double value{};             //the rate at the median time
+        Statistics stats;           //in seconds, no samples for the benchmarks measured in one shot
+        MemoryReport memory;        //taken when the record was reported
+
+        /**
+         * @brief The identity of the record, which is matched against the baseline
+         */
+        [[nodiscard]] std::string key() const;
+    };
+
+    struct Regression
+    {
+        Record baseline;
+        Record current;
+        double change{};    //relative change of the value, negative is slower
+    };
+
+    /**
+     * @brief Set the benchmark the following records belong to
+     */
+    void begin(std::string benchmark, std::string parameter, size_t size, std::string device);
+
+    /**
+     * @brief Print the statistics of a measured benchmark like Statistics::print() and record the rate at the median
+     * @param amount The amount processed in one sample, already scaled to the [unit]
+     */
+    void report(Statistics const& stats, long double amount, const char* unit, std::string variant = {});
+
+    /**
+     * @brief Record a value measured in one shot, the caller prints it
+     */
+    void report(long double value, const char* unit, std::string variant = {});
+
+    /**
+     * @brief Append every following record to [path] as one JSON object per line
+     */
+    void openJsonLines(std::string const& path);
+
+    /**
+     * @brief Append every following record to [path] as CSV, the header is written when the file is empty
+     */
+    void openCsv(std::string const& path);
+
+    /**
+     * @brief Set where the memory report of every record comes from, see Registry::run()
+     */
+    void setMemorySource(std::function<MemoryReport()> source) { memorySource = std::move(source); }
+
+    /**
+     * @brief Set the peak host memory bandwidth in bytes per second, measured by the HostBandwidth benchmarks
+     * @details Once set, every following MB/s or GB/s result is also printed as a percentage of it
+     */
+    void setHostBandwidth(double bytesPerSec) { hostBandwidth = bytesPerSec; }
+
+    [[nodiscard]] double getHostBandwidth() const { return hostBandwidth; }
+
+    [[nodiscard]] std::vector<Record> const& getRecords() const { return records; }
+
+    /**
+     * @brief Load the records written by openJsonLines() or openCsv(), chosen by the .csv extension
+     * @throw ValueError when the file can not be read or parsed
+     */
+    static std::vector<Record> load(std::string const& path);
+
+    /**
+     * @brief Find the records that are more than [threshold] (relative) slower than the baseline
+     * @details Only the records present in both are compared, the latest record wins when a key appears more than once
+     */
+    static std::vector<Regression> compare(std::vector<Record> const& baseline, std::vector<Record> const& current, double threshold);
+
+    /**
+     * @brief Print every compared record with its change, and the regressions at the end
+     * @return The number of regressions
+     */
+    static size_t printComparison(std::ostream& os, std::vector<Record> const& baseline, std::vector<Record> const& current, double threshold);
+
+private:
+    std::string benchmark;
+    std::string parameter;
+    size_t size{};
+    std::string device;
+    double hostBandwidth{};     //bytes per second, 0 when unknown
+    std::function<MemoryReport()> memorySource;
+
+    std::vector<Record> records;
+    std::ofstream jsonLines;
+    std::ofstream csv;
+
+    void add(Record record);
+};
+
+extern Reporter reporter;   //the global reporter
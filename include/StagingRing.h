@@ -0,0 +1,69 @@
+/*****************************************************************//**
+ * \file   StagingRing.h
+ * \brief  Chunked host -> device uploads through a ring of pinned staging buffers
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <CL/opencl.hpp>
+#include <vector>
+#include "MappedBuffer.h"
+
+/**
+ * @brief A ring of CL_MEM_ALLOC_HOST_PTR staging buffers that are mapped once and kept mapped
+ * @details
+ * write() splits the source into chunks. Each chunk is copied with memcpy into the next staging buffer,
+ * then uploaded with a non-blocking clEnqueueWriteBuffer from that pinned memory, so the memcpy of chunk i+1 overlaps the DMA of chunk i.
+ * A staging buffer is only reused after the upload from it has finished.
+ * The source memory can be reused as soon as write() returns, the device buffer is ready when the returned event completes.
+ */
+class StagingRing
+{
+public:
+    constexpr static inline size_t defaultChunkBytes = 4 * 1024 * 1024;
+    constexpr static inline size_t defaultChunkCount = 3;
+
+    /**
+     * @param queue The in-order queue the uploads are enqueued into, must belong to [context]
+     */
+    StagingRing(cl::Context const& context, cl::CommandQueue& queue, size_t chunkBytes = defaultChunkBytes, size_t chunkCount = defaultChunkCount);
+    ~StagingRing();
+
+    StagingRing(StagingRing const&) = delete;
+    StagingRing& operator=(StagingRing const&) = delete;
+
+    /**
+     * @brief Upload [bytes] from [src] to [dst] at [dstOffset]
+     * @param event Receives the event of the last chunk, which completes after all the chunks, can be nullptr
+     */
+    void write(cl::Buffer const& dst, void const* src, size_t bytes, size_t dstOffset = 0, cl::Event* event = nullptr);
+
+    template<typename T>
+    void write(Buffer<T> const& dst, T const* src, size_t count, cl::Event* event = nullptr)
+    {
+        write(dst.getClBuffer(), src, sizeof(T) * count, 0, event);
+    }
+
+    /**
+     * @brief Block until every upload has finished
+     */
+    void wait();
+
+    [[nodiscard]] size_t getChunkBytes() const { return chunkBytes; }
+    [[nodiscard]] size_t getChunkCount() const { return chunks.size(); }
+
+private:
+    struct Chunk
+    {
+        cl::Buffer buffer;
+        void* host;
+        cl::Event uploaded;     //the last upload from this chunk
+    };
+
+    cl::CommandQueue& queue;
+    size_t chunkBytes;
+    std::vector<Chunk> chunks;
+    size_t next = 0;
+};
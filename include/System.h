@@ -1,14 +1,20 @@
 #pragma once
 
+#include <cstddef>
+#include <limits>
+
 #ifdef _WIN32
     #define NOMINMAX
     #include "Windows.h"
+    #include "psapi.h"
 #elif defined __linux__
     #include "sys/sysinfo.h"
+    #include <fstream>
+    #include <string>
 #endif
 
 /**
- * @brief Get physical RAM usage
+ * @brief Get physical RAM usage of the whole system, see GetProcessMemory() for this process only
  * @return The physical RAM usage
  */
 inline auto GetRamUsage()
@@ -22,4 +28,89 @@ inline auto GetRamUsage()
     sysinfo(&memInfo);
     return (memInfo.totalram - memInfo.freeram) * memInfo.mem_unit;
 #endif
-}
\ No newline at end of file
+}
+
+/**
+ * @brief Get the physical RAM of the system
+ */
+inline size_t GetTotalRam()
+{
+#ifdef _WIN32
+    MEMORYSTATUSEX memInfo{ sizeof(MEMORYSTATUSEX) };
+    GlobalMemoryStatusEx(&memInfo);
+    return static_cast<size_t>(memInfo.ullTotalPhys);
+#elif defined __linux__
+    struct sysinfo memInfo;
+    sysinfo(&memInfo);
+    return static_cast<size_t>(memInfo.totalram) * memInfo.mem_unit;
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief Get the physical RAM that can still be allocated without swapping, counting the reclaimable page cache
+ */
+inline size_t GetAvailableRam()
+{
+#ifdef _WIN32
+    MEMORYSTATUSEX memInfo{ sizeof(MEMORYSTATUSEX) };
+    GlobalMemoryStatusEx(&memInfo);
+    return static_cast<size_t>(memInfo.ullAvailPhys);
+#elif defined __linux__
+    /*MemAvailable is the kernel's own estimate, freeram alone misses the page cache*/
+    std::ifstream meminfo{ "/proc/meminfo" };
+    std::string key;
+    size_t kb{};
+    while (meminfo >> key)
+    {
+        if (key == "MemAvailable:" && meminfo >> kb)
+            return kb * 1024;
+        meminfo.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+    struct sysinfo memInfo;
+    sysinfo(&memInfo);
+    return static_cast<size_t>(memInfo.freeram) * memInfo.mem_unit;
+#else
+    return 0;
+#endif
+}
+
+struct ProcessMemory
+{
+    size_t rss{};       //resident set in bytes
+    size_t peakRss{};   //the most resident set in bytes, see ResetPeakRss()
+};
+
+/**
+ * @brief Get the physical RAM used by this process, unlike GetRamUsage() it does not count the other processes
+ * @return 0s where the platform does not tell
+ */
+inline ProcessMemory GetProcessMemory()
+{
+    ProcessMemory memory;
+#ifdef _WIN32
+    PROCESS_MEMORY_COUNTERS counters{};
+    if (GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters)))
+    {
+        memory.rss = counters.WorkingSetSize;
+        memory.peakRss = counters.PeakWorkingSetSize;
+    }
+#elif defined __linux__
+    /*lines like "VmRSS:     1234 kB"*/
+    std::ifstream status{ "/proc/self/status" };
+    std::string key;
+    size_t kb{};
+    std::string unit;
+    while (status >> key)
+    {
+        if (key == "VmRSS:" && status >> kb >> unit)
+            memory.rss = kb * 1024;
+        else if (key == "VmHWM:" && status >> kb >> unit)
+            memory.peakRss = kb * 1024;
+        else
+            status.ignore(std::numeric_limits<std::streamsize>::max(), '\n');
+    }
+#endif
+    return memory;
+}
@@ -0,0 +1,140 @@
+/*****************************************************************//**
+ * \file   TaskGraph.h
+ * \brief  Record transfers and kernels with their dependencies, then submit them at once
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <functional>
+#include <initializer_list>
+#include <string>
+#include <tuple>
+#include <type_traits>
+#include <vector>
+#include "GPU.h"
+
+/**
+ * @brief A DAG of transfer and kernel nodes on a ComputeDevice
+ * @details
+ * Nothing is enqueued while recording. submit() enqueues the whole graph with one flush per queue:
+ * into the out-of-order queue of the device when it is supported, otherwise spread over the in-order streams,
+ * where a node continues the stream of its dependency when it can and the cross-stream dependencies become wait lists.
+ * A node can only depend on nodes recorded before it, so the recording order is always a topological order.
+ * Buffers and kernels are captured by handle, host pointers must stay valid until the graph has finished.
+ */
+class TaskGraph
+{
+public:
+    using Node = size_t;
+    using Dependencies = std::initializer_list<Node>;
+
+    explicit TaskGraph(ComputeDevice& device) : device{ device } {}
+
+    /**
+     * @brief Record a host -> device copy of [count] elements
+     */
+    template<typename T>
+    Node write(Buffer<T> const& buffer, T const* src, size_t count, Dependencies dependencies = {})
+    {
+        return record([buffer = buffer.getClBuffer(), src, bytes = sizeof(T) * count](cl::CommandQueue& queue, std::vector<cl::Event> const* events, cl::Event* event)
+        {
+            queue.enqueueWriteBuffer(buffer, false, 0, bytes, src, events, event);
+        }, dependencies, { Profiler::Operation::Write, sizeof(T) * count });
+    }
+
+    /**
+     * @brief Record a device -> host copy of [count] elements
+     */
+    template<typename T>
+    Node read(Buffer<T> const& buffer, T* dst, size_t count, Dependencies dependencies = {})
+    {
+        return record([buffer = buffer.getClBuffer(), dst, bytes = sizeof(T) * count](cl::CommandQueue& queue, std::vector<cl::Event> const* events, cl::Event* event)
+        {
+            queue.enqueueReadBuffer(buffer, false, 0, bytes, dst, events, event);
+        }, dependencies, { Profiler::Operation::Read, sizeof(T) * count });
+    }
+
+    /**
+     * @brief Record a device -> device copy of [count] elements
+     */
+    template<typename T>
+    Node copy(Buffer<T> const& src, Buffer<T> const& dst, size_t count, Dependencies dependencies = {})
+    {
+        return record([src = src.getClBuffer(), dst = dst.getClBuffer(), bytes = sizeof(T) * count](cl::CommandQueue& queue, std::vector<cl::Event> const* events, cl::Event* event)
+        {
+            queue.enqueueCopyBuffer(src, dst, 0, 0, bytes, events, event);
+        }, dependencies, { Profiler::Operation::Copy, sizeof(T) * count });
+    }
+
+    /**
+     * @brief Record a kernel with tuple of kernel arguments, which is the same as ComputeDevice::enqueueKernel
+     * @details The arguments are set right before the kernel is enqueued, so the same kernel can be recorded several times with different arguments
+     */
+    template<typename Tuple>
+    Node kernel(
+        cl::Kernel kernel,
+        Tuple&& args,
+        const cl::NDRange& offset,
+        const cl::NDRange& global,
+        const cl::NDRange& local = cl::NullRange,
+        Dependencies dependencies = {})
+    {
+        Profiled profiled{ Profiler::Operation::Kernel, 0, kernel.getInfo<CL_KERNEL_FUNCTION_NAME>(), global, local };
+        return record([kernel = std::move(kernel), args = std::decay_t<Tuple>{ std::forward<Tuple>(args) }, offset, global, local](cl::CommandQueue& queue, std::vector<cl::Event> const* events, cl::Event* event) mutable
+        {
+            ComputeDevice::setArgs(kernel, args);
+            queue.enqueueNDRangeKernel(kernel, offset, global, local, events, event);
+        }, dependencies, std::move(profiled));
+    }
+
+    /**
+     * @brief Enqueue all the recorded nodes
+     * @details While the device is profiling, the event of every node is recorded into its profiler like ComputeDevice::enqueueKernel() and the buffer transfers do
+     * @return The completion events, indexed by Node
+     */
+    std::vector<cl::Event> const& submit();
+
+    /**
+     * @brief Get the completion event of a node, only valid after submit()
+     */
+    [[nodiscard]] cl::Event const& event(Node node) const { return events.at(node); }
+
+    [[nodiscard]] std::vector<cl::Event> const& getEvents() const { return events; }
+
+    /**
+     * @brief Block until every node has finished
+     */
+    void wait() const;
+
+    [[nodiscard]] size_t size() const { return tasks.size(); }
+
+private:
+    using Enqueue = std::function<void(cl::CommandQueue&, std::vector<cl::Event> const*, cl::Event*)>;
+
+    /*what the node is recorded as in the Profiler*/
+    struct Profiled
+    {
+        Profiler::Operation operation;
+        size_t bytes{};         //0 for kernels
+        std::string name;       //the kernel name, empty for the other operations
+        cl::NDRange global = cl::NullRange;
+        cl::NDRange local = cl::NullRange;
+    };
+
+    struct Task
+    {
+        Enqueue enqueue;
+        std::vector<Node> dependencies;
+        Profiled profiled;
+    };
+
+    ComputeDevice& device;
+    std::vector<Task> tasks;
+    std::vector<cl::Event> events;
+
+    Node record(Enqueue enqueue, Dependencies dependencies, Profiled profiled);
+    void submitOutOfOrder();
+    void submitToStreams();
+};
@@ -8,8 +8,15 @@
 #pragma once
 #include <cstddef>
 
+class Registry;
+
 namespace test
 {
+    /**
+     * @brief Every benchmark with its default parameter space, registered on the first call
+     */
+    Registry const& Benchmarks();
+
     namespace SanityCheck
     {
         /**
@@ -18,6 +25,11 @@ namespace test
         void PassingStruct();
 
         void Transpose();
+
+        /**
+         * @brief Test uploading, transposing and reading back in 3 different streams chained by events
+         */
+        void Streams();
     }
 
     namespace DataTransfer
@@ -40,6 +52,18 @@ namespace test
          */
         void WriteBufferTotal(size_t bytes);
 
+        /**
+         * @brief Test the performance of copying data into a LargeBuffer, which is split into allocations the device supports
+         * @param bytes Size for the test data to be copied
+         */
+        void WriteLargeBuffer(size_t bytes);
+
+        /**
+         * @brief Test the performance of copying data in chunks through a ring of pinned staging buffers, see StagingRing
+         * @param bytes Size for the test data to be copied
+         */
+        void WriteStagingRing(size_t bytes);
+
         /**
          * @brief Test the performance of copying data using clEnqueueMapBuffer
          * @param bytes Size for the test data to be copied
@@ -68,18 +92,84 @@ namespace test
          */
         void ReadMapBuffer(size_t bytes);
 
+        /**
+         * @brief Test the performance of reading gpu data using several non-blocking clEnqueueMapBuffer in flight
+         * @param bytes Size for the test data to be copied
+         */
+        void ReadMapBufferAsync(size_t bytes);
+
         /**
          * @brief Test the performance of copying data from device -> host
          */
         void CopyToHost();
 
+        /**
+         * @brief Test the performance of writing a [tile] x [tile] block of a large host matrix with clEnqueueWriteBufferRect
+         */
+        void WriteTileRect(size_t tile);
+
+        /**
+         * @brief Test the performance of packing a [tile] x [tile] block of a large host matrix, then writing it with clEnqueueWriteBuffer
+         */
+        void WriteTilePacked(size_t tile);
+
+        /**
+         * @brief Test the performance of reading a [tile] x [tile] block into a large host matrix with clEnqueueReadBufferRect
+         */
+        void ReadTileRect(size_t tile);
+
+        /**
+         * @brief Test the performance of reading a [tile] x [tile] block with clEnqueueReadBuffer, then unpacking it into a large host matrix
+         */
+        void ReadTilePacked(size_t tile);
+
+        /**
+         * @brief Compare the rect transfers against packing on the host and a linear transfer
+         */
+        void RectTransfer();
+
+        /**
+         * @brief Compare clEnqueueWriteBuffer against mapping and unmapping a buffer allocated with ComputeDevice::mallocZeroCopy()
+         * @param bytes Size for the test data
+         */
+        void ZeroCopyWrite(size_t bytes);
+
+        /**
+         * @brief Compare clEnqueueReadBuffer against mapping and unmapping a buffer allocated with ComputeDevice::mallocZeroCopy()
+         * @param bytes Size for the test data
+         */
+        void ZeroCopyRead(size_t bytes);
+
+        /**
+         * @brief Compare the copy-based transfers against zero-copy mapping
+         */
+        void ZeroCopy();
+
+        /**
+         * @brief Test the performance of copying between device buffers with clEnqueueCopyBuffer (whole buffer and sub-range),
+         * clEnqueueCopyBufferRect and an equivalent copy kernel
+         * @param bytes Size of the buffers
+         */
+        void DeviceCopy(size_t bytes);
+
+        /**
+         * @brief Test the performance of filling a device buffer with 1, 4, 16 and 128 byte patterns, with clEnqueueFillBuffer and an equivalent fill kernel
+         * @param bytes Size of the buffer
+         */
+        void Fill(size_t bytes);
+
+        /**
+         * @brief Run the on-device copy and fill tests
+         */
+        void OnDevice();
+
         /**
          * @brief Mapping buffer with CL_MAP_WRITE
          */
         void MapReadWrite();
 
         /**
-         * @brief Test the system RAM I/O speed
+         * @brief Test the system RAM I/O speed, see HostBandwidth
          */
         void RamSpeed();
 
@@ -89,10 +179,93 @@ namespace test
         void DataTransfer();
     }
 
+    /**
+     * @brief How much memory the device really takes, which the size sweeps of the transfer benchmarks follow
+     */
+    namespace Capacity
+    {
+        /**
+         * @brief Print the queried memory limits of the device and the host, then probe the largest single and total allocation
+         * @details The probed limits replace the queried ones in the following size sweeps on this device, see GetCapacity()
+         */
+        void Probe();
+    }
+
+    /**
+     * @brief The host memory bandwidth, the roofline the transfers are judged against
+     */
+    namespace HostBandwidth
+    {
+        /**
+         * @brief Run the STREAM kernels (copy, scale, add, triad) and read-only / write-only loops over 128 MB arrays of doubles on [threads] pinned threads
+         * @details
+         * Every thread initializes the part of the arrays it works on, so on a NUMA system the pages are local to it.
+         * The best rate of any kernel so far is set as the host bandwidth of the reporter, see Reporter::setHostBandwidth().
+         */
+        void Stream(size_t threads);
+    }
+
+    /**
+     * @brief The transfers from/to host buffers backed by small pages, transparent huge pages and explicit huge pages
+     * @details Each one also reports the first touch of a fresh buffer, which is where the page faults are paid
+     */
+    namespace HugePages
+    {
+        void CopyHostPtr(size_t bytes);
+
+        void WriteBuffer(size_t bytes);
+
+        void WriteMapBuffer(size_t bytes);
+
+        void ReadBuffer(size_t bytes);
+
+        void ReadMapBuffer(size_t bytes);
+    }
+
+    namespace Numa
+    {
+        /**
+         * @brief Test clEnqueueWriteBuffer and clEnqueueReadBuffer with the host buffer on each NUMA node, submitted from a thread pinned to each node
+         * @details On a single-node machine this is one row
+         */
+        void Transfer(size_t bytes);
+    }
+
+    /**
+     * @brief The latency of small transfers, where the fixed cost of every call dominates
+     * @details
+     * The rates are transfers per second, the distribution printed with them is the latency of one transfer.
+     * Each transfer is measured as:
+     *  - enqueue: the host-side cost of the non-blocking enqueue call alone
+     *  - completion: from the non-blocking enqueue until its event has completed
+     *  - blocking: the blocking call
+     */
+    namespace Latency
+    {
+        /**
+         * @brief Creating a buffer with CL_MEM_COPY_HOST_PTR, which is only blocking
+         */
+        void CopyHostPtr(size_t bytes);
+
+        void WriteBuffer(size_t bytes);
+
+        /**
+         * @brief Mapping a buffer followed by unmapping it
+         */
+        void MapUnmap(size_t bytes);
+
+        void ReadBuffer(size_t bytes);
+
+        /**
+         * @brief Run all test
+         */
+        void Latency();
+    }
+
     namespace MemoryType
     {
         /**
-         * @brief Allocate buffer with CL_USE_HOST_PTR
+         * @brief Allocate buffer with CL_USE_HOST_PTR in aligned host memory, and check whether mapping it returns that memory
          */
         void UseHostPtr();
 
@@ -112,8 +285,9 @@ namespace test
     {
         /**
          * @brief Test the performance of compiling OpenCL kernels using 1 thread
+         * @return The number of kernels compiled per second
          */
-        void SingleThread(bool saveKernel = false);
+        long double SingleThread(bool saveKernel = false);
 
         /**
          * @brief Test the performance of compiling OpenCL kernels using multi-threading with std::async
@@ -135,6 +309,20 @@ namespace test
          */
         void MultiThreadLoadFromBinary();
 
+#ifndef ANDROID
+        /**
+         * @brief Test the performance of Compiler::buildAll(), which compiles and links on a pool of worker threads
+         * @details Every program is linked with LinkHelper.cl, which is compiled only once, and the link stage is also reported on its own
+         * @param singleThreadRate The result of SingleThread(), to report the speed-up
+         */
+        void BuildPipeline(long double singleThreadRate);
+
+        /**
+         * @brief Test the performance of Compiler::build() with a cold and then a warm binary cache
+         */
+        void BinaryCache();
+#endif
+
         /**
          * @brief Run all test
          */
@@ -153,6 +341,11 @@ namespace test
          */
         void ProfileDataTransfer();
 
+        /**
+         * @brief Profile every command of a reduction, and print the queueing delay versus the execution time per kernel and transfer
+         */
+        void ProfileReduction();
+
     }
 
     namespace Benchmark
@@ -198,6 +391,47 @@ namespace test
             void Reduction();
         }
 
+        namespace Allocation
+        {
+            /**
+             * @brief Allocate and release a buffer of [bytes] with clCreateBuffer/clReleaseMemObject every time
+             */
+            void PerCall(size_t bytes);
+
+            /**
+             * @brief Allocate and release a buffer of [bytes] through ComputeDevice::malloc, which reuses the buffers of its BufferPool
+             */
+            void Pooled(size_t bytes);
+
+            /**
+             * @brief Compare the allocation rate with and without the pool
+             */
+            void Allocation();
+        }
+
+        namespace LaunchOverhead
+        {
+            /**
+             * @brief Launch a small kernel with ComputeDevice::enqueueKernel, which sets every argument and flushes each launch
+             */
+            void EnqueueKernel(size_t launches);
+
+            /**
+             * @brief Launch the same kernel with a KernelLaunch, which re-sets only the 2 swapped buffers and does not flush each launch
+             */
+            void BoundLaunch(size_t launches);
+
+            /**
+             * @brief Launch the same kernel with a KernelLaunch whose arguments never change, enqueued in one call
+             */
+            void BoundLaunchUnchanged(size_t launches);
+
+            /**
+             * @brief Test the host overhead of many small launches, in launches per second
+             */
+            void LaunchOverhead();
+        }
+
         namespace MatrixMultiplication
         {
 
@@ -290,5 +524,22 @@ namespace test
              */
             void Convolution();
         }
+
+        namespace Pipeline
+        {
+            /**
+             * @brief Multiply 256 MB of doubles in chunks of [chunkBytes], serially and with the upload, SelfMul kernel and download of different chunks overlapped
+             * @details
+             * The pipelined runs use 2 queues (upload + download share one) and 3 queues,
+             * and report the throughput against the serial run and the overlap efficiency:
+             * the share of the time that could be hidden (serial time - the longest stage) that really was hidden.
+             */
+            void UploadComputeDownload(size_t chunkBytes);
+
+            /**
+             * @brief Run the pipeline over a range of chunk sizes
+             */
+            void Pipeline();
+        }
     }
 }
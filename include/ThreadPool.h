@@ -0,0 +1,72 @@
+/*****************************************************************//**
+ * \file   ThreadPool.h
+ * \brief  A fixed-size pool of worker threads
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+/**
+ * @brief A fixed number of workers taking tasks from one FIFO queue
+ * @details
+ * Unlike one std::async per task, the number of threads never exceeds the pool size no matter how many tasks are submitted.
+ * The destructor finishes every submitted task before joining the workers.
+ */
+class ThreadPool
+{
+public:
+    /**
+     * @param threadCount The number of workers, 0 means defaultThreadCount()
+     */
+    explicit ThreadPool(size_t threadCount = 0);
+    ~ThreadPool();
+
+    ThreadPool(ThreadPool const&) = delete;
+    ThreadPool& operator=(ThreadPool const&) = delete;
+
+    /**
+     * @brief Queue a task
+     * @return The future of the result, which also carries the exception thrown by the task
+     */
+    template<typename Func>
+    [[nodiscard]] auto submit(Func&& func) -> std::future<std::invoke_result_t<std::decay_t<Func>>>
+    {
+        using Result = std::invoke_result_t<std::decay_t<Func>>;
+        /*std::function needs a copyable target, so the move-only packaged_task is shared*/
+        auto task = std::make_shared<std::packaged_task<Result()>>(std::forward<Func>(func));
+        auto future = task->get_future();
+        {
+            std::lock_guard lock{ mutex };
+            tasks.emplace([task] { (*task)(); });
+        }
+        hasTask.notify_one();
+        return future;
+    }
+
+    [[nodiscard]] size_t size() const { return workers.size(); }
+
+    /**
+     * @brief The number of hardware threads, at least 1
+     */
+    [[nodiscard]] static size_t defaultThreadCount();
+
+private:
+    std::vector<std::thread> workers;
+    std::queue<std::function<void()>> tasks;
+    std::mutex mutex;
+    std::condition_variable hasTask;
+    bool stopping = false;
+
+    void work();
+};
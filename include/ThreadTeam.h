@@ -0,0 +1,70 @@
+/*****************************************************************//**
+ * \file   ThreadTeam.h
+ * \brief  A fixed team of threads, optionally pinned to cores, running the same function together
+ *
+ * \author Wenhao Li
+ * \date   October 2026
+ *********************************************************************/
+#pragma once
+
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <utility>
+#include <vector>
+
+/**
+ * @brief Runs one function on every thread of the team at once, each one called with its index
+ * @details
+ * Unlike ThreadPool, the work is split by the caller, and thread i always gets index i.
+ * So memory first touched by thread i (eg. in a first run that initializes it) is placed on the NUMA node of thread i,
+ * and later runs of thread i find it local. That only holds while the threads stay on their cores, hence the pinning.
+ */
+class ThreadTeam
+{
+public:
+    /**
+     * @param threadCount The number of threads, at least 1
+     * @param pin Pin thread i to logical core i (modulo the core count), where the platform supports it
+     */
+    explicit ThreadTeam(size_t threadCount, bool pin = true);
+    ~ThreadTeam();
+
+    ThreadTeam(ThreadTeam const&) = delete;
+    ThreadTeam& operator=(ThreadTeam const&) = delete;
+
+    /**
+     * @brief Call [func] with 0..size()-1 on the threads of the team, and wait for all of them
+     * @details An exception thrown by [func] is rethrown here, after every thread has returned
+     */
+    void run(std::function<void(size_t)> const& func);
+
+    [[nodiscard]] size_t size() const { return workers.size(); }
+
+    /**
+     * @brief Whether the threads were really pinned, false when the platform does not support it or it failed
+     */
+    [[nodiscard]] bool isPinned() const { return pinned; }
+
+    /**
+     * @brief The range [begin, end) of [count] items that thread [index] of [threads] works on, split as evenly as possible
+     */
+    [[nodiscard]] static std::pair<size_t, size_t> split(size_t count, size_t index, size_t threads);
+
+private:
+    std::vector<std::thread> workers;
+    std::mutex mutex;
+    std::condition_variable started;
+    std::condition_variable finished;
+    std::function<void(size_t)> const* task{};
+    size_t generation{};        //increased by every run()
+    size_t running{};           //threads that have not finished the current run
+    std::exception_ptr error;   //the first exception of the current run
+    bool stopping = false;
+    bool pinned = false;
+
+    void work(size_t index);
+};
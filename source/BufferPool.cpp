@@ -0,0 +1,173 @@
+#include "BufferPool.h"
+#include <algorithm>
+#include <iterator>
+
+BufferPool::Lease::Lease(cl::Buffer buffer, cl_mem_flags flags, size_t sizeClass, std::weak_ptr<BufferPool> pool)
+    : buffer{ std::move(buffer) },
+    flags{ flags },
+    sizeClass{ sizeClass },
+    pool{ std::move(pool) }
+{
+}
+
+BufferPool::Lease::~Lease()
+{
+    if (sizeClass == 0)
+        return;
+    if (auto const owner = pool.lock())
+    {
+        try {
+            owner->release(std::move(buffer), flags, sizeClass);
+        }
+        catch (...) {
+            /*the buffer is simply released instead*/
+        }
+    }
+}
+
+BufferPool::BufferPool(cl::Context context, size_t capacity)
+    : context{ std::move(context) },
+    capacity{ capacity }
+{
+}
+
+size_t BufferPool::sizeClassOf(size_t bytes)
+{
+    if (bytes <= minSizeClass)
+        return minSizeClass;
+
+    /*the largest power of 2 below [bytes], split into 4 steps*/
+    size_t power = minSizeClass;
+    while (power * 2 < bytes)
+        power *= 2;
+    auto const step = power / 4;
+    return (bytes + step - 1) / step * step;
+}
+
+std::shared_ptr<BufferPool::Lease> BufferPool::acquire(cl_mem_flags flags, size_t bytes)
+{
+    auto const sizeClass = sizeClassOf(bytes);
+    bool cacheable{};
+    {
+        std::lock_guard lock{ mutex };
+        cacheable = sizeClass <= capacity;
+        if (cacheable)
+        {
+            if (auto const iter = freeLists.find({ sizeClass, flags }); iter != freeLists.end() && !iter->second.empty())
+            {
+                /*the latest released first, it is the most likely to be still in the cache of the device*/
+                auto& list = iter->second;
+                auto const ready = std::find_if(list.rbegin(), list.rend(), [](Cached& cached) { return cached.completed(); });
+                if (ready != list.rend())
+                {
+                    auto buffer = std::move(ready->buffer);
+                    list.erase(std::next(ready).base());
+                    --stats.cachedBuffers;
+                    stats.cachedBytes -= sizeClass;
+                    ++stats.hits;
+                    return std::make_shared<Lease>(std::move(buffer), flags, sizeClass, weak_from_this());
+                }
+            }
+        }
+        ++stats.misses;
+    }
+
+    /*allocate outside the lock*/
+    cl::Buffer buffer{ context, flags, cacheable ? sizeClass : bytes };
+    return std::make_shared<Lease>(std::move(buffer), flags, cacheable ? sizeClass : 0, weak_from_this());
+}
+
+bool BufferPool::Cached::completed()
+{
+    /*an error status also means the command is over*/
+    auto const pending = std::any_of(fences.cbegin(), fences.cend(), [](cl::Event const& fence)
+    {
+        return fence.getInfo<CL_EVENT_COMMAND_EXECUTION_STATUS>() > CL_COMPLETE;
+    });
+    if (!pending)
+        fences.clear();
+    return !pending;
+}
+
+void BufferPool::release(cl::Buffer buffer, cl_mem_flags flags, size_t sizeClass)
+{
+    std::vector<cl::CommandQueue> fenced;
+    {
+        std::lock_guard lock{ mutex };
+        if (sizeClass > capacity)
+            return;
+        fenced = queues;
+    }
+
+    /*a marker without wait list completes after every command enqueued before it, which includes the ones using the buffer*/
+    std::vector<cl::Event> fences(fenced.size());
+    for (size_t i = 0; i < fenced.size(); ++i)
+    {
+        fenced[i].enqueueMarkerWithWaitList(nullptr, &fences[i]);
+        fenced[i].flush();
+    }
+
+    std::vector<cl::Buffer> evicted;
+    std::lock_guard lock{ mutex };
+    if (sizeClass > capacity)
+        return;
+    evictUntil(capacity - sizeClass, evicted);
+    freeLists[{ sizeClass, flags }].push_back(Cached{ std::move(buffer), std::move(fences) });
+    ++stats.cachedBuffers;
+    stats.cachedBytes += sizeClass;
+}
+
+void BufferPool::evictUntil(size_t bytes, std::vector<cl::Buffer>& evicted)
+{
+    for (auto iter = freeLists.rbegin(); iter != freeLists.rend() && stats.cachedBytes > bytes; ++iter)
+    {
+        auto& list = iter->second;
+        while (!list.empty() && stats.cachedBytes > bytes)
+        {
+            evicted.push_back(std::move(list.back().buffer));
+            list.pop_back();
+            --stats.cachedBuffers;
+            stats.cachedBytes -= iter->first.first;
+            ++stats.evictions;
+        }
+    }
+}
+
+void BufferPool::trim(size_t bytes)
+{
+    std::vector<cl::Buffer> evicted;
+    std::lock_guard lock{ mutex };
+    evictUntil(bytes, evicted);
+}
+
+void BufferPool::setQueues(std::vector<cl::CommandQueue> queues)
+{
+    std::lock_guard lock{ mutex };
+    this->queues = std::move(queues);
+}
+
+void BufferPool::setCapacity(size_t bytes)
+{
+    std::vector<cl::Buffer> evicted;
+    std::lock_guard lock{ mutex };
+    capacity = bytes;
+    evictUntil(bytes, evicted);
+}
+
+size_t BufferPool::getCapacity() const
+{
+    std::lock_guard lock{ mutex };
+    return capacity;
+}
+
+BufferPool::Stats BufferPool::getStats() const
+{
+    std::lock_guard lock{ mutex };
+    return stats;
+}
+
+void BufferPool::resetStats()
+{
+    std::lock_guard lock{ mutex };
+    stats.hits = stats.misses = stats.evictions = 0;
+}
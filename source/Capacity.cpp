@@ -0,0 +1,157 @@
+#include "Capacity.h"
+#include "Error.hpp"
+#include "SizeLiteral.hpp"
+#include "System.h"
+#include <algorithm>
+#include <limits>
+#include <map>
+
+/*the probed limits of every device, see ProbeAllocationLimits()*/
+static std::map<cl_device_id, AllocationLimits> probedLimits;
+
+static bool IsUnifiedMemory(cl::Device const& device)
+{
+    return device.getInfo<CL_DEVICE_HOST_UNIFIED_MEMORY>() || (device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU) != 0;
+}
+
+static size_t HostBudget(size_t hostRam, size_t hostAvailable)
+{
+    if (hostRam == 0)   //the platform does not tell
+        return std::numeric_limits<size_t>::max();
+    auto const reserve = std::max<size_t>(512_mb, hostRam / 8);
+    return hostAvailable > reserve ? hostAvailable - reserve : 0;
+}
+
+size_t DeviceCapacity::hostBudget() const
+{
+    return HostBudget(hostRam, hostAvailable);
+}
+
+size_t DeviceCapacity::transferLimit(size_t hostCopies) const
+{
+    return std::min(maxAllocation, totalLimit(hostCopies));
+}
+
+size_t DeviceCapacity::totalLimit(size_t hostCopies) const
+{
+    auto const buffers = hostCopies + (unifiedMemory ? 1 : 0);
+    return std::min(globalMemory, buffers == 0 ? hostBudget() : hostBudget() / buffers);
+}
+
+DeviceCapacity GetCapacity(cl::Device const& device)
+{
+    DeviceCapacity capacity;
+    capacity.maxAllocation = device.getInfo<CL_DEVICE_MAX_MEM_ALLOC_SIZE>();
+    capacity.globalMemory = device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
+    capacity.unifiedMemory = IsUnifiedMemory(device);
+    capacity.hostRam = GetTotalRam();
+    capacity.hostAvailable = GetAvailableRam();
+
+    if (auto const iter = probedLimits.find(device()); iter != probedLimits.cend())
+    {
+        capacity.maxAllocation = iter->second.largestAllocation;
+        capacity.globalMemory = iter->second.largestTotal;
+        capacity.probed = true;
+    }
+    return capacity;
+}
+
+AllocationLimits ProbeAllocationLimits(cl::Context const& context, cl::CommandQueue& queue, cl::Device const& device, size_t granularity)
+{
+    if (granularity == 0)
+        throw ValueError{};
+
+    size_t const globalMemory = device.getInfo<CL_DEVICE_GLOBAL_MEM_SIZE>();
+    auto const unified = IsUnifiedMemory(device);
+    auto const hostRam = GetTotalRam();
+    AllocationLimits limits;
+    std::vector<cl::Buffer> live;
+
+    auto const tryAllocate = [&](size_t bytes)
+    {
+        /*the host budget is taken again every time, because the buffers held so far come out of it*/
+        if (unified && HostBudget(hostRam, GetAvailableRam()) < bytes)
+        {
+            limits.hostReserveReached = true;
+            return false;
+        }
+        try {
+            /*filled, so the runtime can not defer the allocation until the first use*/
+            cl::Buffer buffer{ context, CL_MEM_READ_WRITE, bytes };
+            queue.enqueueFillBuffer(buffer, cl_uchar{}, 0, bytes);
+            queue.finish();
+            live.push_back(std::move(buffer));
+            return true;
+        }
+        catch (cl::Error const&)
+        {
+            try {
+                queue.finish();
+            }
+            catch (cl::Error const&) {}
+            return false;
+        }
+    };
+
+    /*binary search in units of [granularity], [low] is known to fit and [high] is known not to*/
+    size_t low = 0;
+    size_t high = globalMemory / granularity + 1;
+    while (high - low > 1)
+    {
+        auto const mid = low + (high - low) / 2;
+        if (tryAllocate(mid * granularity))
+            low = mid;
+        else
+            high = mid;
+        live.clear();
+    }
+    limits.largestAllocation = low * granularity;
+
+    /*hold as many of the largest buffers as possible, then halve them to fill up the rest*/
+    size_t total{};
+    auto chunk = limits.largestAllocation;
+    while (chunk >= granularity)
+    {
+        if (total + chunk <= globalMemory && tryAllocate(chunk))
+            total += chunk;
+        else
+            chunk = chunk / 2 / granularity * granularity;
+    }
+    limits.largestTotal = total;
+    live.clear();
+
+    /*nothing could be allocated, eg. the fill is not supported, so the queried limits are kept*/
+    if (limits.largestAllocation != 0)
+        probedLimits[device()] = limits;
+    return limits;
+}
+
+std::vector<size_t> SizeSweep(size_t first, size_t limit)
+{
+    std::vector<size_t> sizes;
+    auto const take = [&](size_t size)
+    {
+        if (size >= first && size <= limit)
+            sizes.push_back(size);
+    };
+    for (auto const size : { 4_kb, 1_mb, 32_mb, 512_mb })
+        take(size);
+    for (size_t size = 1_gb; size <= limit; size *= 2)
+    {
+        take(size);
+        if (size > limit / 2)
+            break;
+    }
+
+    /*round the limit down to 1/8 of its power of 2, eg. 5.7gb to 5.5gb*/
+    if (limit < 4_kb)
+        return sizes;
+    size_t power = 1;
+    while (power <= limit / 2)
+        power *= 2;
+    auto const step = std::max<size_t>(power / 8, 1_kb);
+    auto const largest = limit / step * step;
+    if (largest >= first && (sizes.empty() || largest >= sizes.back() + sizes.back() / 4))
+        sizes.push_back(largest);
+    return sizes;
+}
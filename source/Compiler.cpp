@@ -1,8 +1,17 @@
 #include "Compiler.h"
+#include "ThreadPool.h"
 #include <fstream>
 #include <iostream>
 #include <numeric>
 #include <future>
+#include <cstdint>
+#include <cstdlib>
+#include <random>
+#include <sstream>
+#include <iomanip>
+#include <string_view>
+#include <algorithm>
+#include <optional>
 
 
 static auto GetSource(std::string const& fileName)
@@ -16,44 +25,72 @@ static auto GetSource(std::string const& fileName)
     return std::string{ std::istreambuf_iterator<char>{f}, std::istreambuf_iterator<char>{} };
 }
 
-std::vector<cl::Kernel> Compiler::build(const char* kernelName) const
+static void PrintBuildLog(cl::Program const& program)
+{
+    const auto buildLog = program.getBuildInfo<CL_PROGRAM_BUILD_LOG>();
+    for (const auto& log : buildLog)
+        std::cerr << log.first.getInfo<CL_DEVICE_NAME>() << ":\t" << log.second << '\n';
+}
+
+static std::vector<cl::Kernel> CreateKernels(cl::Program& program)
 {
-    cl::Program program{ context, GetSource(std::string{kernelName} + ".cl") };
-    try {
-        program.build();
-    }
-    catch (cl::Error& err)
-    {
-        std::cerr << "Build program failed. Code: " << err.err() << '\n';
-        const auto buildLog = program.getBuildInfo<CL_PROGRAM_BUILD_LOG>();
-        for (const auto& log : buildLog)
-            std::cerr << log.first.getInfo<CL_DEVICE_NAME>() << ":\t" << log.second << '\n';
-        throw std::runtime_error{ "Build program failed" };
-    }
     std::vector<cl::Kernel> kernels;
     program.createKernels(&kernels);
+#ifdef DEBUG
     std::cerr << "Kernel creation success!\n";
+#endif
     return kernels;
 }
 
-std::vector<cl::Kernel> Compiler::build(const char* kernelName, CompileOption const& essentialFlag) const
+cl::Program Compiler::buildProgram(std::string const& source, std::string const& options) const
 {
-    cl::Program program{ context, GetSource(std::string{kernelName} + ".cl") };
+#ifndef ANDROID
+    std::vector<cl::Device> devices;
+    if (binaryCache.isEnabled())
+    {
+        devices = context.getInfo<CL_CONTEXT_DEVICES>();
+        if (auto program = binaryCache.load(context, devices, source, options); program() != nullptr)
+            return program;
+    }
+#endif
+    cl::Program program{ context, source };
     try {
-        program.build(essentialFlag.option.c_str());
+        program.build(options.c_str());
     }
     catch (cl::Error& err)
     {
-        std::cerr << "Build program failed. Code: " << err.err() << '\n';
-        const auto buildLog = program.getBuildInfo<CL_PROGRAM_BUILD_LOG>();
-        for (const auto& log : buildLog)
-            std::cerr << log.first.getInfo<CL_DEVICE_NAME>() << ":\t" << log.second << '\n';
+        std::cerr << "Build program failed with flag" << options << " Code: " << err.err() << '\n';
+        PrintBuildLog(program);
         throw std::runtime_error{ "Build program failed" };
     }
-    std::vector<cl::Kernel> kernels;
-    program.createKernels(&kernels);
-    std::cerr << "Kernel creation success!\n";
-    return kernels;
+#ifndef ANDROID
+    if (binaryCache.isEnabled())
+        binaryCache.store(program, source, options);
+#endif
+    return program;
+}
+
+cl::Program Compiler::buildProgram(std::string const& source, CompileOption const& essentialFlag, CompileOption const& otherFlags) const
+{
+    try {
+        return buildProgram(source, essentialFlag.option + otherFlags.option);
+    }
+    catch (std::runtime_error&) {
+        std::cerr << "Retry with flag" << essentialFlag.option << '\n';
+    }
+    return buildProgram(source, essentialFlag.option);
+}
+
+std::vector<cl::Kernel> Compiler::build(const char* kernelName) const
+{
+    auto program = buildProgram(GetSource(std::string{ kernelName } + ".cl"), std::string{});
+    return CreateKernels(program);
+}
+
+std::vector<cl::Kernel> Compiler::build(const char* kernelName, CompileOption const& essentialFlag) const
+{
+    auto program = buildProgram(GetSource(std::string{ kernelName } + ".cl"), essentialFlag.option);
+    return CreateKernels(program);
 }
 
 void Compiler::buildAll() const
@@ -61,36 +98,122 @@ void Compiler::buildAll() const
 }
 
 #ifndef ANDROID
-void Compiler::buildAll(std::unordered_map<std::string, cl::Kernel>& storage, CompileOption const& essentialFlag,
-    CompileOption const& otherFlags) const
+/*Compile a source to an object, with the same flag fallback as Compiler::build()*/
+static cl::Program CompileObject(cl::Context const& context, std::filesystem::path const& path, std::string const& options, std::string const& fallbackOptions)
+{
+    cl::Program program{ context, GetSource(path.string()) };
+    try {
+        program.compile(options.c_str());
+        return program;
+    }
+    catch (cl::Error&) {
+    }
+    try {
+        program.compile(fallbackOptions.c_str());
+    }
+    catch (cl::Error& err)
+    {
+        std::cerr << "Compile <" << path.string() << "> failed. Code: " << err.err() << '\n';
+        PrintBuildLog(program);
+        throw std::runtime_error{ "Compile program failed" };
+    }
+    return program;
+}
+
+Compiler::BuildStats Compiler::buildAll(std::unordered_map<std::string, cl::Kernel>& storage, CompileOption const& essentialFlag,
+    CompileOption const& otherFlags, std::filesystem::path const& directory, std::vector<std::filesystem::path> const& helpers, size_t threadCount) const
 {
-    std::mutex storageMutex;
+    auto const start = std::chrono::steady_clock::now();
+    BuildStats stats{};
+
+    std::vector<std::filesystem::path> sources;
+    for (auto&& entry : std::filesystem::directory_iterator{ directory })
+    {
+        auto const& path = entry.path();
+        if (path.extension() != ".cl")
+            continue;
+        if (std::none_of(helpers.cbegin(), helpers.cend(), [&path](std::filesystem::path const& helper)
+        {
+            std::error_code ec;
+            return std::filesystem::equivalent(path, helper, ec);
+        }))
+            sources.push_back(path);
+    }
+
+    auto const options = essentialFlag.option + otherFlags.option;
+    std::vector<cl::Program> helperObjects;
+    std::vector<std::optional<cl::Program>> objects(sources.size());
+
+    /*the pool is destroyed first, so no task outlives the locals above*/
+    ThreadPool pool{ threadCount };
+    stats.threads = pool.size();
 
-    std::vector<std::future<void>> buildFutures;
-    buildFutures.reserve(50);
+    /*Stage 1: compile the helpers and every source*/
+    {
+        std::vector<std::future<cl::Program>> helperFutures;
+        std::vector<std::future<cl::Program>> objectFutures;
+        for (auto const& helper : helpers)
+            helperFutures.push_back(pool.submit([this, &helper, &options, &essentialFlag] { return CompileObject(context, helper, options, essentialFlag.option); }));
+        for (auto const& source : sources)
+            objectFutures.push_back(pool.submit([this, &source, &options, &essentialFlag] { return CompileObject(context, source, options, essentialFlag.option); }));
+
+        for (size_t i = 0; i < objectFutures.size(); ++i)
+        {
+            try {
+                objects[i] = objectFutures[i].get();
+            }
+            catch (std::exception const&) {
+                ++stats.failed;
+            }
+        }
+        /*every program needs the helpers, so a broken helper fails the whole build*/
+        for (auto& future : helperFutures)
+            helperObjects.push_back(future.get());
+    }
+    auto const compiled = std::chrono::steady_clock::now();
+    stats.compile = compiled - start;
 
-    /*loop through all the .cl file*/
-    std::filesystem::directory_iterator dirIter{ "." };
-    for(auto&& entry:dirIter)
+    /*Stage 2: link every object with the helpers*/
     {
-        if(auto path=entry.path(); path.extension()==".cl")
+        std::vector<std::future<std::vector<cl::Kernel>>> linkFutures;
+        for (size_t i = 0; i < objects.size(); ++i)
         {
-            buildFutures.emplace_back(std::async(std::launch::async, [&path, &storageMutex, &storage, &essentialFlag, &otherFlags, this]()mutable
+            if (!objects[i])
+                continue;
+            linkFutures.push_back(pool.submit([&object = *objects[i], &path = sources[i], &helperObjects]
             {
-                auto name = path.stem().string();
-                auto kernels=build(name.c_str(), essentialFlag, otherFlags);
+                std::vector<cl::Program> inputs{ object };
+                inputs.insert(inputs.end(), helperObjects.cbegin(), helperObjects.cend());
+                try {
+                    auto program = cl::linkProgram(inputs);
+                    std::vector<cl::Kernel> kernels;
+                    program.createKernels(&kernels);
+                    return kernels;
+                }
+                catch (cl::Error& err)
                 {
-                    std::lock_guard lock{ storageMutex };
-                    for(auto& kernel:kernels)
-                        storage.insert({ std::move(name), std::move(kernel) });
+                    std::cerr << "Link <" << path.string() << "> failed. Code: " << err.err() << '\n';
+                    throw;
                 }
             }));
         }
-    }
 
-    /*wait for all futures to finish */
-    for (auto& future : buildFutures)
-        future.wait();
+        for (auto& future : linkFutures)
+        {
+            try {
+                for (auto& kernel : future.get())
+                    storage.insert_or_assign(kernel.getInfo<CL_KERNEL_FUNCTION_NAME>(), std::move(kernel));
+                ++stats.programs;
+            }
+            catch (std::exception const&) {
+                ++stats.failed;
+            }
+        }
+    }
+    auto const linked = std::chrono::steady_clock::now();
+    stats.link = linked - compiled;
+    stats.total = linked - start;
+    return stats;
 }
 #endif
 
@@ -106,59 +229,15 @@ std::vector<cl::Kernel> Compiler::loadAll()
 std::vector<cl::Kernel> Compiler::build(const char* kernelName, CompileOption const& essentialFlag,
                                         CompileOption const& otherFlags) const
 {
-    cl::Program program{ context, GetSource(std::string{kernelName}+".cl") };
-    try {
-        program.build((essentialFlag.option+otherFlags.option).c_str());
-    }
-    catch (cl::Error& err) {
-        std::cerr << "Build program error with flag" << essentialFlag.option << otherFlags.option << " Code: " << err.err() << '\n';
-    }
-    try {
-        program.build(essentialFlag.option.c_str());
-    }
-    catch (cl::Error& err)
-    {
-        std::cerr << "Build program failed. Code: " << err.err() << '\n';
-        const auto buildLog = program.getBuildInfo<CL_PROGRAM_BUILD_LOG>();
-        for (const auto& log : buildLog)
-            std::cerr << log.first.getInfo<CL_DEVICE_NAME>() << ":\t" << log.second << '\n';
-        throw std::runtime_error{ "Build program failed" };
-    }
-    std::vector<cl::Kernel> kernels;
-    program.createKernels(&kernels);
-#ifdef DEBUG
-    std::cerr << "Kernel creation success!\n";
-#endif
-    return kernels;
+    auto program = buildProgram(GetSource(std::string{ kernelName } + ".cl"), essentialFlag, otherFlags);
+    return CreateKernels(program);
 }
 
 #ifndef ANDROID
 std::vector<cl::Kernel> Compiler::build(std::filesystem::path const& path, CompileOption const& essentialFlag, CompileOption const& otherFlags) const
 {
-    cl::Program program{ context, GetSource(path.string()) };
-    try {
-        program.build((essentialFlag.option + otherFlags.option).c_str());
-    }
-    catch (cl::Error& err) {
-        std::cerr << "Build program error with flag" << essentialFlag.option << otherFlags.option << " Code: " << err.err() << '\n';
-    }
-    try {
-        program.build(essentialFlag.option.c_str());
-    }
-    catch (cl::Error& err)
-    {
-        std::cerr << "Build program failed. Code: " << err.err() << '\n';
-        const auto buildLog = program.getBuildInfo<CL_PROGRAM_BUILD_LOG>();
-        for (const auto& log : buildLog)
-            std::cerr << log.first.getInfo<CL_DEVICE_NAME>() << ":\t" << log.second << '\n';
-        throw std::runtime_error{ "Build program failed" };
-    }
-    std::vector<cl::Kernel> kernels;
-    program.createKernels(&kernels);
-#ifdef DEBUG
-    std::cerr << "Kernel creation success!\n";
-#endif
-    return kernels;
+    auto program = buildProgram(GetSource(path.string()), essentialFlag, otherFlags);
+    return CreateKernels(program);
 }
 #endif
 
@@ -212,3 +291,176 @@ std::vector<cl::Kernel> Compiler::loadKernel(std::filesystem::path const& path,
     return kernels;
 }
 #endif
+
+#ifndef ANDROID
+BinaryCache binaryCache{ BinaryCache::directoryFromEnvironment() };
+
+/*FNV-1a, only used to name the entries, the entry itself is checked against the full key*/
+static std::uint64_t Hash(std::string const& data, std::uint64_t hash = 14695981039346656037ull)
+{
+    for (unsigned char c : data)
+    {
+        hash ^= c;
+        hash *= 1099511628211ull;
+    }
+    return hash;
+}
+
+/*An entry is: magic, then the length-prefixed driver version, device name, options and source, then the binary*/
+static constexpr char EntryMagic[] = "CLBIN1";
+
+static void WriteString(std::ostream& os, std::string const& str)
+{
+    std::uint64_t const size = str.size();
+    os.write(reinterpret_cast<const char*>(&size), sizeof(size));
+    os.write(str.data(), static_cast<std::streamsize>(str.size()));
+}
+
+static bool ReadString(std::istream& is, std::string& str)
+{
+    std::uint64_t size{};
+    if (!is.read(reinterpret_cast<char*>(&size), sizeof(size)))
+        return false;
+    str.resize(static_cast<size_t>(size));
+    return static_cast<bool>(is.read(str.data(), static_cast<std::streamsize>(size)));
+}
+
+BinaryCache::BinaryCache(std::filesystem::path directory) : directory{ std::move(directory) }, enabled{ !this->directory.empty() }
+{
+}
+
+std::filesystem::path BinaryCache::directoryFromEnvironment()
+{
+    auto const dir = std::getenv("CLBENCH_BINARY_CACHE");
+    if (dir == nullptr)
+        return "kernel_cache";
+    if (std::string_view{ dir } == "off" || *dir == '\0')
+        return {};
+    return dir;
+}
+
+std::filesystem::path BinaryCache::entryOf(cl::Device const& device, std::string const& source, std::string const& options) const
+{
+    auto const hash = Hash(device.getInfo<CL_DEVICE_NAME>(), Hash(options, Hash(source)));
+    std::ostringstream name;
+    name << std::hex << std::setw(16) << std::setfill('0') << hash << ".bin";
+    return directory / name.str();
+}
+
+cl::Program BinaryCache::load(cl::Context const& context, std::vector<cl::Device> const& devices, std::string const& source, std::string const& options) const
+{
+    if (!isEnabled() || devices.empty())
+        return {};
+
+    cl::Program::Binaries binaries;
+    binaries.reserve(devices.size());
+    for (auto const& device : devices)
+    {
+        auto const path = entryOf(device, source, options);
+        std::ifstream f{ path, std::ios::binary };
+        if (!f.is_open())
+            return {};
+
+        char magic[sizeof(EntryMagic)]{};
+        std::string driver, deviceName, entryOptions, entrySource;
+        if (!f.read(magic, sizeof(magic))
+            || std::string_view{ magic, sizeof(magic) } != std::string_view{ EntryMagic, sizeof(EntryMagic) }
+            || !ReadString(f, driver) || !ReadString(f, deviceName) || !ReadString(f, entryOptions) || !ReadString(f, entrySource))
+        {
+            f.close();
+            std::error_code ec;
+            std::filesystem::remove(path, ec);     //truncated or from an older format
+            return {};
+        }
+        if (driver != device.getInfo<CL_DRIVER_VERSION>())
+        {
+            f.close();
+            std::error_code ec;
+            std::filesystem::remove(path, ec);     //built by another driver, rebuild it
+            return {};
+        }
+        if (deviceName != device.getInfo<CL_DEVICE_NAME>() || entryOptions != options || entrySource != source)
+            return {};  //a hash collision, leave the other entry alone
+        binaries.emplace_back(std::istreambuf_iterator<char>{ f }, std::istreambuf_iterator<char>{});
+    }
+
+    try {
+        cl::Program program{ context, devices, binaries };
+        program.build(devices, options.c_str());
+        return program;
+    }
+    catch (cl::Error& err)
+    {
+        /*the driver rejected the binary, drop it so it is rebuilt from source*/
+        std::cerr << "Cached program binary rejected. Code: " << err.err() << '\n';
+        for (auto const& device : devices)
+        {
+            std::error_code ec;
+            std::filesystem::remove(entryOf(device, source, options), ec);
+        }
+        return {};
+    }
+}
+
+void BinaryCache::store(cl::Program const& program, std::string const& source, std::string const& options) const
+{
+    if (!isEnabled())
+        return;
+
+    auto const devices = program.getInfo<CL_PROGRAM_DEVICES>();
+    auto const binSizes = program.getInfo<CL_PROGRAM_BINARY_SIZES>();
+    cl::Program::Binaries binaries;
+    binaries.reserve(binSizes.size());
+    for (auto size : binSizes)
+        binaries.emplace_back(size);
+    program.getInfo(CL_PROGRAM_BINARIES, &binaries);
+
+    std::error_code ec;
+    std::filesystem::create_directories(directory, ec);
+    if (ec)
+    {
+        std::cerr << "Cannot create binary cache directory: " << directory.string() << '\n';
+        return;
+    }
+
+    thread_local std::mt19937_64 random{ std::random_device{}() };
+    for (size_t i = 0; i < devices.size() && i < binaries.size(); ++i)
+    {
+        if (binaries[i].empty())
+            continue;
+
+        auto const path = entryOf(devices[i], source, options);
+        auto temp = path;
+        temp += ".tmp" + std::to_string(random());
+        {
+            std::ofstream f{ temp, std::ios::binary };
+            f.write(EntryMagic, sizeof(EntryMagic));
+            WriteString(f, devices[i].getInfo<CL_DRIVER_VERSION>());
+            WriteString(f, devices[i].getInfo<CL_DEVICE_NAME>());
+            WriteString(f, options);
+            WriteString(f, source);
+            f.write(reinterpret_cast<const char*>(binaries[i].data()), static_cast<std::streamsize>(binaries[i].size()));
+            if (!f)
+            {
+                f.close();
+                std::filesystem::remove(temp, ec);
+                continue;
+            }
+        }
+        /*rename() replaces the old entry atomically, readers see either the old or the new file*/
+        std::filesystem::rename(temp, path, ec);
+        if (ec)
+            std::filesystem::remove(temp, ec);
+    }
+}
+
+void BinaryCache::clear() const
+{
+    std::error_code ec;
+    for (auto const& entry : std::filesystem::directory_iterator{ directory, ec })
+    {
+        if (entry.path().extension() == ".bin")
+            std::filesystem::remove(entry.path(), ec);
+    }
+}
+#endif
@@ -1,68 +1,111 @@
 #include "GPU.h"
+#include "KernelCache.h"
+#include "System.h"
 
 #include <iostream>
 #include <vector>
 #include <fstream>
 #include <cassert>
+#include <algorithm>
+#include <cstdlib>
+#include <cctype>
 
 static auto GetCLDevice()
 {
-    /*Get CL devices*/
+    /*Get CL devices of every type on every platform*/
     std::vector<cl::Platform> platforms;
     cl::Platform::get(&platforms);
     std::vector<cl::Device> devices;
     for (auto& platform : platforms)
     {
         std::vector<cl::Device> platformDevice;
-        platform.getDevices(CL_DEVICE_TYPE_GPU, &platformDevice);
+        try {
+            platform.getDevices(CL_DEVICE_TYPE_ALL, &platformDevice);
+        }
+        catch (cl::Error const& err) {
+            //a platform without any device reports CL_DEVICE_NOT_FOUND, which is not an error for us
+            if (err.err() != CL_DEVICE_NOT_FOUND)
+                throw;
+        }
         std::copy(platformDevice.cbegin(), platformDevice.cend(), std::back_inserter(devices));
     }
+
+    /*Keep the gpus in front, so the default device is still the first gpu whenever there is one*/
+    std::stable_partition(devices.begin(), devices.end(), [](cl::Device const& device)
+    {
+        return (device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_GPU) != 0;
+    });
 #ifdef DEBUG
     for(auto const& device:devices)
     {
-        std::cout << "GPU: " << device.getInfo<CL_DEVICE_NAME>() << " found\n";
+        std::cout << "Device: " << device.getInfo<CL_DEVICE_NAME>() << " found\n";
     }
 #endif
     return devices;
 }
 
-static auto GetGPU(std::vector<cl::Device> const& devices)
+static auto DeviceFactory()
 {
-    std::vector<ComputeDevice> gpus;
-    gpus.reserve(devices.size());
-    try {
-        for (auto const& device : devices)
-            gpus.emplace_back(device);
-    }
-    catch(cl::Error& err) {
-        //The exception of "clCreateCommandQueueWithProperties" will happen there is a device does NOT
-        //support the target OpenCL standard which is defined by the macro CL_HPP_MINIMUM_OPENCL_VERSION
-        //but because the emplace_back has strong exception guarantee, the problematic device will not be added 
-        std::cerr << "GetGPU() error: " << err.what() << " Code: " << err.err() << " -> " << GetErrorDescription(err.err()) << '\n';
+    auto clDevices = GetCLDevice();
+    Devices result;
+    result.gpus.reserve(clDevices.size());
+    for (auto const& device : clDevices)
+    {
+        try {
+            result.gpus.emplace_back(device);
+            result.devices.push_back(device);
+        }
+        catch(cl::Error& err) {
+            //The exception of "clCreateCommandQueueWithProperties" will happen there is a device does NOT
+            //support the target OpenCL standard which is defined by the macro CL_HPP_MINIMUM_OPENCL_VERSION
+            //but because the emplace_back has strong exception guarantee, the problematic device will not be added 
+            std::cerr << "DeviceFactory() error: " << err.what() << " Code: " << err.err() << " -> " << GetErrorDescription(err.err()) << '\n';
+        }
     }
     //However we need to ensure there is at least 1 device usable
 #ifdef DEBUG
-    assert(!gpus.empty());
+    assert(!result.gpus.empty());
 #endif
-    return gpus;
-}
 
-static auto DeviceFactory()
-{
-    auto clDevices = GetCLDevice();
-    return Devices{
-        GetGPU(clDevices),
-        clDevices,
-        //cl::Context{clDevices}
-    };
+    /*Honor CLBENCH_DEVICE before anything gets the chance to use the default device*/
+    auto const selector = DeviceSelector::fromEnvironment();
+    for (size_t i = 0, matched = 0; i < result.devices.size(); ++i)
+    {
+        if (selector.matches(result.devices[i]) && matched++ == selector.index)
+        {
+            std::swap(result.gpus[gpuIndex], result.gpus[i]);
+            std::swap(result.devices[gpuIndex], result.devices[i]);
+            break;
+        }
+    }
+    return result;
 }
 
 
-ComputeDevice::ComputeDevice(cl::Device device)
+ComputeDevice::ComputeDevice(cl::Device device, size_t streamCount)
     :cl::Device{ std::move(device) },
     cl::Context{static_cast<cl::Device&>(*this)},
-    cl::CommandQueue{ static_cast<cl::Context const&>(*this), static_cast<cl::Device&>(*this)}
+    cl::CommandQueue{ static_cast<cl::Context const&>(*this), static_cast<cl::Device&>(*this)},
+    bufferPool{ std::make_shared<BufferPool>(static_cast<cl::Context const&>(*this)) },
+    profiler{ std::make_shared<Profiler>() },
+    memoryTracker{ std::make_shared<MemoryTracker>() }
+{
+    setStreamCount(streamCount);
+}
+
+MemoryReport ComputeDevice::getMemoryReport() const
 {
+    auto const process = GetProcessMemory();
+    auto const buffers = memoryTracker->getStats();
+    MemoryReport report;
+    report.rss = process.rss;
+    report.peakRss = process.peakRss;
+    report.deviceBytes = buffers.liveBytes;
+    report.devicePeakBytes = buffers.peakBytes;
+    report.memObjects = buffers.liveBuffers + bufferPool->getStats().cachedBuffers;
+    report.kernels = kernelCache.kernelCount();
+    report.programs = kernelCache.programCount();
+    return report;
 }
 
 ComputeDevice::~ComputeDevice()
@@ -80,13 +123,83 @@ ComputeDevice::~ComputeDevice()
 
 void ComputeDevice::finish()
 {
+    if (getCLQueue()() == nullptr)   //moved-from
+        return;
     cl::CommandQueue::finish();
+    for (auto& queue : streams)
+        queue.finish();
+    if (outOfOrderQueue() != nullptr)
+        outOfOrderQueue.finish();
+}
+
+bool ComputeDevice::supportsOutOfOrder() const
+{
+    return (getCLDevice().getInfo<CL_DEVICE_QUEUE_PROPERTIES>() & CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE) != 0;
+}
+
+cl::CommandQueue& ComputeDevice::getOutOfOrderQueue()
+{
+    if (outOfOrderQueue() == nullptr)
+    {
+        if (!supportsOutOfOrder())
+            throw NotImplementException{};
+        outOfOrderQueue = cl::CommandQueue{ getCLContext(), getCLDevice(), queueProperties() | CL_QUEUE_OUT_OF_ORDER_EXEC_MODE_ENABLE };
+        updatePoolQueues();
+    }
+    return outOfOrderQueue;
+}
+
+cl::CommandQueue& ComputeDevice::stream(size_t index)
+{
+    return index == 0 ? getCLQueue() : streams.at(index - 1);
+}
+
+void ComputeDevice::setStreamCount(size_t count)
+{
+    if (count == 0)
+        throw ValueError{};
+
+    for (auto& queue : streams)
+        queue.finish();
+    streams.resize(std::min(streams.size(), count - 1));
+    while (streams.size() < count - 1)
+        streams.emplace_back(getCLContext(), getCLDevice(), queueProperties());
+    updatePoolQueues();
+}
+
+void ComputeDevice::updatePoolQueues()
+{
+    std::vector<cl::CommandQueue> queues{ getCLQueue() };
+    queues.insert(queues.end(), streams.cbegin(), streams.cend());
+    if (outOfOrderQueue() != nullptr)
+        queues.push_back(outOfOrderQueue);
+    bufferPool->setQueues(std::move(queues));
+}
+
+cl_command_queue_properties ComputeDevice::queueProperties() const
+{
+    return profiler->isEnabled() ? CL_QUEUE_PROFILING_ENABLE : 0;
+}
+
+void ComputeDevice::setProfiling(bool enable)
+{
+    if (enable == isProfiling())
+        return;
+
+    finish();
+    profiler->setEnabled(enable);
+    /*assigned in place, so the buffers holding a reference to a queue keep working*/
+    getCLQueue() = cl::CommandQueue{ getCLContext(), getCLDevice(), queueProperties() };
+    for (auto& queue : streams)
+        queue = cl::CommandQueue{ getCLContext(), getCLDevice(), queueProperties() };
+    outOfOrderQueue = cl::CommandQueue{};   //recreated on next use
+    updatePoolQueues();
 }
 
 
 Devices devices=DeviceFactory();
 ComputeDevice& gpu = devices.gpus[gpuIndex];
-//TODO: The compiler instance is using the default gpu's context
+//The compiler instance is using the selected device's context, which follows UseDevice()
 
 Compiler compiler{devices.gpus[gpuIndex].getCLContext()};
 unsigned Initializer::count;
@@ -123,26 +236,21 @@ Initializer::~Initializer()
 
 cl::Kernel& ComputeDevice::operator[](const char* kernelName)
 {
-    //First find the whether the required kernel is already compiled
-    if (auto iter = kernels.find(kernelName); iter != kernels.end())
-        return iter->second;
+    static CompileOption const essentialFlag{ CompileOption::Optimize::FastMath };
+    static CompileOption const otherFlags{ CompileOption::Std::CL2_0 };
+    return kernel(kernelName, essentialFlag, otherFlags);
+}
 
-    //Not found, so compile it
-    for (auto&& compiledKernels : compiler.build(kernelName, { CompileOption::Optimize::FastMath }, { CompileOption::Std::CL2_0 }))
-    {
-        kernels.insert({ kernelName, std::move(compiledKernels) });
-#ifdef DEBUG
-        std::cout << "Kernel: <" << kernelName << "> created\n";
-#endif
-    }
-    return kernels[kernelName];
+cl::Kernel& ComputeDevice::kernel(const char* programName, CompileOption const& essentialFlag, CompileOption const& otherFlags, const char* kernelName)
+{
+    return kernelCache.get(getCLContext(), getCLDevice(), programName, essentialFlag, otherFlags, kernelName);
 }
 
 
 #include "when.hpp"
 Vendor ComputeDevice::getVendor() const
 {
-    return when(gpu.getCLDevice().getInfo<CL_DEVICE_VENDOR>(),
+    return when(getCLDevice().getInfo<CL_DEVICE_VENDOR>(),
         "AMD",      Vendor::AMD,
         "NVIDIA Corporation",   Vendor::NVIDIA,
         "QUALCOMM",             Vendor::Qualcomm,
@@ -150,3 +258,136 @@ Vendor ComputeDevice::getVendor() const
         Else(),                 Vendor::Other
     );
 }
+
+
+static bool ContainsIgnoreCase(std::string const& str, std::string const& pattern)
+{
+    return std::search(str.cbegin(), str.cend(), pattern.cbegin(), pattern.cend(), [](char lhs, char rhs)
+    {
+        return std::tolower(static_cast<unsigned char>(lhs)) == std::tolower(static_cast<unsigned char>(rhs));
+    }) != str.cend();
+}
+
+DeviceSelector DeviceSelector::parse(std::string const& spec)
+{
+    DeviceSelector selector;
+    size_t begin = 0;
+    while (begin < spec.size())
+    {
+        auto end = spec.find(',', begin);
+        if (end == std::string::npos)
+            end = spec.size();
+        auto const item = spec.substr(begin, end - begin);
+        begin = end + 1;
+
+        if (item.empty())
+            continue;
+        if (item == "all")
+        {
+            selector.all = true;
+            continue;
+        }
+        if (std::all_of(item.cbegin(), item.cend(), [](char c) { return std::isdigit(static_cast<unsigned char>(c)); }))
+        {
+            selector.index = std::stoull(item);
+            continue;
+        }
+
+        auto const colon = item.find(':');
+        auto const key = item.substr(0, colon);
+        auto const value = colon == std::string::npos ? std::string{} : item.substr(colon + 1);
+        if (key == "type")
+        {
+            selector.type = when(value,
+                "gpu",          static_cast<cl_device_type>(CL_DEVICE_TYPE_GPU),
+                "cpu",          static_cast<cl_device_type>(CL_DEVICE_TYPE_CPU),
+                "accelerator",  static_cast<cl_device_type>(CL_DEVICE_TYPE_ACCELERATOR),
+                Else(),         static_cast<cl_device_type>(CL_DEVICE_TYPE_ALL)
+            );
+        }
+        else if (key == "platform")
+            selector.platform = value;
+        else if (key == "vendor")
+            selector.vendor = value;
+        else if (key == "name")
+            selector.name = value;
+        else if (key == "index")
+            selector.index = std::stoull(value);
+        else
+            std::cerr << "Unknown device selector: <" << item << "> ignored\n";
+    }
+    return selector;
+}
+
+DeviceSelector DeviceSelector::fromEnvironment()
+{
+    if (auto const spec = std::getenv("CLBENCH_DEVICE"))
+        return parse(spec);
+    return {};
+}
+
+bool DeviceSelector::matches(cl::Device const& device) const
+{
+    if ((device.getInfo<CL_DEVICE_TYPE>() & type) == 0)
+        return false;
+    if (!platform.empty() && !ContainsIgnoreCase(cl::Platform{ device.getInfo<CL_DEVICE_PLATFORM>() }.getInfo<CL_PLATFORM_NAME>(), platform))
+        return false;
+    if (!vendor.empty() && !ContainsIgnoreCase(device.getInfo<CL_DEVICE_VENDOR>(), vendor))
+        return false;
+    if (!name.empty() && !ContainsIgnoreCase(device.getInfo<CL_DEVICE_NAME>(), name))
+        return false;
+    return true;
+}
+
+std::vector<cl::Device> FindDevices(DeviceSelector const& selector)
+{
+    std::vector<cl::Device> matched;
+    std::copy_if(devices.devices.cbegin(), devices.devices.cend(), std::back_inserter(matched), [&selector](cl::Device const& device)
+    {
+        return selector.matches(device);
+    });
+
+    /*UseDevice() reorders devices, so report them in discovery order, which is the gpus first*/
+    std::stable_partition(matched.begin(), matched.end(), [](cl::Device const& device)
+    {
+        return (device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_GPU) != 0;
+    });
+
+    if (selector.all)
+        return matched;
+    if (selector.index >= matched.size())
+    {
+        std::cerr << "No device matches the selector at index " << selector.index << '\n';
+        return {};
+    }
+    return { matched[selector.index] };
+}
+
+void UseDevice(cl::Device const& device)
+{
+    auto const iter = std::find_if(devices.devices.cbegin(), devices.devices.cend(), [&device](cl::Device const& d) { return d() == device(); });
+    if (iter == devices.devices.cend())
+        throw ValueError{};
+
+    auto const index = static_cast<size_t>(iter - devices.devices.cbegin());
+    if (index == gpuIndex)
+        return;
+
+    /*The global compiler refers to the context of the device at [gpuIndex], so swapping the devices retargets it too*/
+    gpu.finish();
+    std::swap(devices.gpus[gpuIndex], devices.gpus[index]);
+    std::swap(devices.devices[gpuIndex], devices.devices[index]);
+}
+
+void ListDevices()
+{
+    for (auto const& device : devices.devices)
+    {
+        std::cout << (device() == gpu.getDevice()() ? "* " : "  ")
+            << device.getInfo<CL_DEVICE_NAME>()
+            << " [" << cl::Platform{ device.getInfo<CL_DEVICE_PLATFORM>() }.getInfo<CL_PLATFORM_NAME>() << "] "
+            << device.getInfo<CL_DEVICE_VENDOR>() << ' '
+            << ((device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_GPU) ? "GPU" : (device.getInfo<CL_DEVICE_TYPE>() & CL_DEVICE_TYPE_CPU) ? "CPU" : "Other")
+            << '\n';
+    }
+}
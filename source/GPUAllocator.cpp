@@ -0,0 +1,176 @@
+#include "GPUAllocator.h"
+#include <algorithm>
+#include <cstdint>
+#include <cstdlib>
+#include "Error.hpp"
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #include "Windows.h"
+    #include <malloc.h>
+#else
+    #include <unistd.h>
+#endif
+
+#ifdef __linux__
+    #include <sys/mman.h>
+#endif
+
+PageKind hostPageKind = PageKind::Small;
+
+size_t PageSize()
+{
+    static size_t const pageSize = []
+    {
+#ifdef _WIN32
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return static_cast<size_t>(info.dwPageSize);
+#else
+        auto const size = sysconf(_SC_PAGESIZE);
+        return size > 0 ? static_cast<size_t>(size) : size_t{ 4096 };
+#endif
+    }();
+    return pageSize;
+}
+
+size_t ZeroCopyAlignment(cl::Device const& device)
+{
+    /*CL_DEVICE_MEM_BASE_ADDR_ALIGN is in bits*/
+    return std::max(PageSize(), static_cast<size_t>(device.getInfo<CL_DEVICE_MEM_BASE_ADDR_ALIGN>()) / 8);
+}
+
+void* AlignedAlloc(size_t bytes, size_t alignment)
+{
+    alignment = std::max(alignment, sizeof(void*));
+    bytes = std::max<size_t>(bytes, 1);    //a 0 byte allocation may return nullptr
+#ifdef _WIN32
+    auto const ptr = _aligned_malloc(bytes, alignment);
+#else
+    void* ptr{};
+    if (posix_memalign(&ptr, alignment, bytes) != 0)
+        ptr = nullptr;
+#endif
+    if (ptr == nullptr)
+        throw std::bad_alloc{};
+    return ptr;
+}
+
+void AlignedFree(void* ptr) noexcept
+{
+#ifdef _WIN32
+    _aligned_free(ptr);
+#else
+    std::free(ptr);
+#endif
+}
+
+std::string ToString(PageKind kind)
+{
+    switch (kind)
+    {
+    case PageKind::Small: return "small";
+    case PageKind::Transparent: return "thp";
+    case PageKind::Huge: return "huge";
+    }
+    return {};
+}
+
+PageKind ParsePageKind(std::string const& kind)
+{
+    for (auto const candidate : { PageKind::Small, PageKind::Transparent, PageKind::Huge })
+    {
+        if (ToString(candidate) == kind)
+            return candidate;
+    }
+    throw ValueError{};
+}
+
+/*the size actually mapped for [bytes] of [kind]*/
+static size_t MappedSize(size_t bytes, PageKind kind)
+{
+    auto const page = kind == PageKind::Small ? PageSize() : hugePageSize;
+    return (std::max<size_t>(bytes, 1) + page - 1) / page * page;
+}
+
+void* PageAlloc(size_t bytes, PageKind kind)
+{
+    auto const size = MappedSize(bytes, kind);
+#ifdef _WIN32
+    if (kind == PageKind::Transparent)
+        throw NotImplementException{};
+    void* ptr{};
+    if (kind == PageKind::Huge)
+    {
+        /*needs the SeLockMemoryPrivilege of the user*/
+        auto const largePage = GetLargePageMinimum();
+        if (largePage == 0)
+            throw NotImplementException{};
+        ptr = VirtualAlloc(nullptr, (size + largePage - 1) / largePage * largePage, MEM_COMMIT | MEM_RESERVE | MEM_LARGE_PAGES, PAGE_READWRITE);
+    }
+    else
+        ptr = VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE);
+    if (ptr == nullptr)
+        throw std::bad_alloc{};
+    return ptr;
+#elif defined __linux__
+    if (kind == PageKind::Huge)
+    {
+    #ifdef MAP_HUGETLB
+        auto const ptr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (ptr == MAP_FAILED)
+            throw std::bad_alloc{};
+        return ptr;
+    #else
+        throw NotImplementException{};
+    #endif
+    }
+
+    /*transparent huge pages are only used for 2 MB aligned ranges, so map one huge page more and trim both ends*/
+    auto const extra = kind == PageKind::Transparent ? hugePageSize : 0;
+    auto const mapped = mmap(nullptr, size + extra, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mapped == MAP_FAILED)
+        throw std::bad_alloc{};
+    if (kind == PageKind::Small)
+        return mapped;
+
+    auto const address = reinterpret_cast<uintptr_t>(mapped);
+    auto const aligned = (address + hugePageSize - 1) / hugePageSize * hugePageSize;
+    if (aligned != address)
+        munmap(mapped, aligned - address);
+    if (auto const tail = address + size + extra - (aligned + size); tail != 0)
+        munmap(reinterpret_cast<void*>(aligned + size), tail);
+    #ifdef MADV_HUGEPAGE
+    if (madvise(reinterpret_cast<void*>(aligned), size, MADV_HUGEPAGE) != 0)
+    {
+        munmap(reinterpret_cast<void*>(aligned), size);
+        throw NotImplementException{};
+    }
+    return reinterpret_cast<void*>(aligned);
+    #else
+    munmap(reinterpret_cast<void*>(aligned), size);
+    throw NotImplementException{};
+    #endif
+#else
+    if (kind != PageKind::Small)
+        throw NotImplementException{};
+    return AlignedAlloc(size, PageSize());
+#endif
+}
+
+void PageFree(void* ptr, size_t bytes, PageKind kind) noexcept
+{
+    if (ptr == nullptr)
+        return;
+#ifdef _WIN32
+    (void)bytes;
+    (void)kind;
+    VirtualFree(ptr, 0, MEM_RELEASE);
+#elif defined __linux__
+    munmap(ptr, MappedSize(bytes, kind));
+#else
+    (void)bytes;
+    (void)kind;
+    AlignedFree(ptr);
+#endif
+}
@@ -0,0 +1,95 @@
+#include "KernelCache.h"
+#include <iostream>
+#include <mutex>
+
+KernelCache kernelCache;
+
+KernelCache::Key::Key(KeyView const& view)
+    : cache{ view.cache },
+    program{ view.program },
+    essentialFlag{ view.essentialFlag },
+    otherFlags{ view.otherFlags },
+    device{ view.device },
+    context{ view.context },
+    kernel{ view.kernel }
+{
+}
+
+cl::Kernel& KernelCache::get(cl::Context const& context, cl::Device const& device, const char* programName, CompileOption const& essentialFlag, CompileOption const& otherFlags, const char* kernelName)
+{
+    thread_local std::map<Key, ThreadKernel, Less> threadKernels;
+
+    KeyView const key{ this, programName, essentialFlag.option, otherFlags.option, device(), context(), kernelName ? kernelName : "" };
+    auto const currentGeneration = generation.load(std::memory_order_acquire);
+
+    /*Fast path: this thread already has the kernel, no lock at all*/
+    auto iter = threadKernels.find(key);
+    if (iter != threadKernels.end() && iter->second.generation == currentGeneration)
+        return iter->second.kernel;
+
+    auto const program = getProgram(context, key, essentialFlag, otherFlags);
+    cl::Kernel kernel{ program.program, kernelName ? kernelName : program.firstKernel.c_str() };
+    if (iter == threadKernels.end())
+        iter = threadKernels.emplace(Key{ key }, ThreadKernel{ currentGeneration, std::move(kernel) }).first;
+    else
+        iter->second = ThreadKernel{ currentGeneration, std::move(kernel) };
+#ifdef DEBUG
+    std::cout << "Kernel: <" << programName << "> created\n";
+#endif
+    return iter->second.kernel;
+}
+
+KernelCache::Program KernelCache::getProgram(cl::Context const& context, KeyView const& key, CompileOption const& essentialFlag, CompileOption const& otherFlags)
+{
+    /*The program is cached with an empty kernel name*/
+    auto programKey = key;
+    programKey.kernel = {};
+
+    std::shared_future<Program> future;
+    {
+        std::shared_lock lock{ mutex };
+        if (auto const iter = programs.find(programKey); iter != programs.end())
+            future = iter->second;
+    }
+    if (future.valid())
+        return future.get();
+
+    /*Not found, so build it outside the lock. Whoever inserts first builds, the others wait on the same future*/
+    std::promise<Program> promise;
+    {
+        std::unique_lock lock{ mutex };
+        auto const [iter, inserted] = programs.try_emplace(Key{ programKey }, promise.get_future().share());
+        future = iter->second;
+        if (!inserted)
+        {
+            lock.unlock();
+            return future.get();
+        }
+    }
+
+    try {
+        auto const kernels = Compiler{ context }.build(std::string{ key.program }.c_str(), essentialFlag, otherFlags);
+        promise.set_value(Program{ kernels.front().getInfo<CL_KERNEL_PROGRAM>(), kernels.front().getInfo<CL_KERNEL_FUNCTION_NAME>() });
+    }
+    catch (...) {
+        promise.set_exception(std::current_exception());
+        /*let the next lookup try again*/
+        std::unique_lock lock{ mutex };
+        if (auto const iter = programs.find(programKey); iter != programs.end())
+            programs.erase(iter);
+    }
+    return future.get();
+}
+
+void KernelCache::clear()
+{
+    std::unique_lock lock{ mutex };
+    programs.clear();
+    generation.fetch_add(1, std::memory_order_release);
+}
+
+size_t KernelCache::programCount() const
+{
+    std::shared_lock lock{ mutex };
+    return programs.size();
+}
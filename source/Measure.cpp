@@ -0,0 +1,78 @@
+#include "Measure.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+#include <numeric>
+
+MeasureOptions measureOptions;
+
+/*linear interpolation between the closest ranks of the sorted samples*/
+static double percentile(std::vector<double> const& sorted, double p)
+{
+    auto const rank = p * static_cast<double>(sorted.size() - 1);
+    auto const lower = static_cast<size_t>(rank);
+    auto const upper = std::min(lower + 1, sorted.size() - 1);
+    return sorted[lower] + (sorted[upper] - sorted[lower]) * (rank - static_cast<double>(lower));
+}
+
+Statistics Statistics::compute(std::vector<double> samples, size_t warmup)
+{
+    Statistics stats;
+    stats.warmup = warmup;
+    stats.samples = samples.size();
+    if (samples.empty())
+        return stats;
+
+    std::sort(samples.begin(), samples.end());
+    auto const count = static_cast<double>(samples.size());
+    stats.min = samples.front();
+    stats.median = percentile(samples, 0.5);
+    stats.p95 = percentile(samples, 0.95);
+    stats.p99 = percentile(samples, 0.99);
+    stats.mean = std::accumulate(samples.cbegin(), samples.cend(), 0.0) / count;
+    if (samples.size() > 1)
+    {
+        auto const squares = std::accumulate(samples.cbegin(), samples.cend(), 0.0, [mean = stats.mean](double sum, double sample)
+        {
+            return sum + (sample - mean) * (sample - mean);
+        });
+        stats.stddev = std::sqrt(squares / (count - 1));
+    }
+    stats.relativeError = stats.mean > 0 ? confidenceHalfWidth(samples.size(), stats.stddev) / stats.mean : 0;
+    return stats;
+}
+
+double Statistics::confidenceHalfWidth(size_t samples, double stddev)
+{
+    /*two-sided 95% quantiles of Student's t, indexed by the degrees of freedom*/
+    constexpr double t[] = {
+        0, 12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (samples < 2)
+        return 0;
+    auto const degrees = samples - 1;
+    auto const quantile = degrees < std::size(t) ? t[degrees] : 1.96;
+    return quantile * stddev / std::sqrt(static_cast<double>(samples));
+}
+
+void Statistics::print(std::ostream& os, long double amount, const char* unit) const
+{
+    auto const us = [](double seconds) { return seconds * 1e6; };
+    auto const flags = os.flags();
+    os << perSec(amount) << ' ' << unit
+        << " (best " << (min > 0 ? amount / min : 0) << ' ' << unit << ")"
+        << std::fixed << std::setprecision(1)
+        << " | us: min " << us(min)
+        << " median " << us(median)
+        << " mean " << us(mean)
+        << " p95 " << us(p95)
+        << " p99 " << us(p99)
+        << " stddev " << us(stddev)
+        << " | n = " << samples
+        << " +-" << relativeError * 100 << '%'
+        << (converged ? "" : " (budget)")
+        << '\n';
+    os.flags(flags);
+}
@@ -0,0 +1,63 @@
+#include "MemoryTracker.h"
+#include <fstream>
+#include <iomanip>
+#include "SizeLiteral.hpp"
+
+MemoryTracker::Allocation::Allocation(std::shared_ptr<MemoryTracker> tracker, size_t bytes)
+    : tracker{ std::move(tracker) },
+    bytes{ bytes }
+{
+    this->tracker->liveBuffers.fetch_add(1, std::memory_order_relaxed);
+    this->tracker->allocations.fetch_add(1, std::memory_order_relaxed);
+    auto const live = this->tracker->liveBytes.fetch_add(bytes, std::memory_order_relaxed) + bytes;
+    auto peak = this->tracker->peakBytes.load(std::memory_order_relaxed);
+    while (live > peak && !this->tracker->peakBytes.compare_exchange_weak(peak, live, std::memory_order_relaxed))
+        ;
+}
+
+MemoryTracker::Allocation::~Allocation()
+{
+    tracker->liveBuffers.fetch_sub(1, std::memory_order_relaxed);
+    tracker->liveBytes.fetch_sub(bytes, std::memory_order_relaxed);
+}
+
+std::shared_ptr<MemoryTracker::Allocation> MemoryTracker::track(size_t bytes)
+{
+    return std::make_shared<Allocation>(shared_from_this(), bytes);
+}
+
+MemoryTracker::Stats MemoryTracker::getStats() const
+{
+    return {
+        liveBuffers.load(std::memory_order_relaxed),
+        liveBytes.load(std::memory_order_relaxed),
+        peakBytes.load(std::memory_order_relaxed),
+        allocations.load(std::memory_order_relaxed)
+    };
+}
+
+void MemoryTracker::resetPeak()
+{
+    peakBytes.store(liveBytes.load(std::memory_order_relaxed), std::memory_order_relaxed);
+}
+
+void MemoryReport::print(std::ostream& os) const
+{
+    auto const flags = os.flags();
+    auto const precision = os.precision();
+    os << std::fixed << std::setprecision(1)
+        << "  memory: rss " << toMb(rss) << " MB (peak " << toMb(peakRss) << " MB)"
+        << ", device buffers " << toMb(deviceBytes) << " MB (peak " << toMb(devicePeakBytes) << " MB)"
+        << ", " << memObjects << " cl_mem, " << kernels << " cl_kernel, " << programs << " cl_program\n";
+    os.flags(flags);
+    os.precision(precision);
+}
+
+void ResetPeakRss()
+{
+#if defined __linux__
+    /*"5" resets VmHWM to the current resident set*/
+    std::ofstream clearRefs{ "/proc/self/clear_refs" };
+    clearRefs << "5";
+#endif
+}
@@ -0,0 +1,203 @@
+#include "Numa.h"
+#include <algorithm>
+#include <cctype>
+#include <fstream>
+#include <string>
+#include <thread>
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #include "Windows.h"
+#elif defined __linux__
+    #include <sched.h>
+    #include <sys/syscall.h>
+    #include <unistd.h>
+#endif
+
+NumaPlacement numaPlacement;
+
+#ifdef __linux__
+/*parse a Linux cpu/node list like "0-3,8-11"*/
+static std::vector<size_t> ParseList(std::string const& list)
+{
+    std::vector<size_t> values;
+    size_t begin = 0;
+    while (begin < list.size())
+    {
+        auto end = list.find(',', begin);
+        if (end == std::string::npos)
+            end = list.size();
+        auto const item = list.substr(begin, end - begin);
+        begin = end + 1;
+        if (item.empty() || !std::isdigit(static_cast<unsigned char>(item.front())))
+            continue;
+
+        auto const dash = item.find('-');
+        auto const first = std::stoull(item.substr(0, dash));
+        auto const last = dash == std::string::npos ? first : std::stoull(item.substr(dash + 1));
+        for (auto value = first; value <= last; ++value)
+            values.push_back(value);
+    }
+    return values;
+}
+
+static std::vector<size_t> ReadList(std::string const& path)
+{
+    std::ifstream file{ path };
+    std::string list;
+    if (!std::getline(file, list))
+        return {};
+    try {
+        return ParseList(list);
+    }
+    catch (std::exception const&)
+    {
+        return {};
+    }
+}
+#endif
+
+std::vector<size_t> NumaNodes()
+{
+    std::vector<size_t> nodes;
+#ifdef _WIN32
+    ULONG highest{};
+    if (GetNumaHighestNodeNumber(&highest))
+    {
+        for (ULONG node = 0; node <= highest; ++node)
+        {
+            ULONGLONG mask{};
+            if (GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask) && mask != 0)
+                nodes.push_back(node);
+        }
+    }
+#elif defined __linux__
+    nodes = ReadList("/sys/devices/system/node/online");
+#endif
+    if (nodes.empty())
+        nodes.push_back(0);
+    return nodes;
+}
+
+std::vector<size_t> NumaNodeCpus(size_t node)
+{
+#ifdef _WIN32
+    std::vector<size_t> cpus;
+    ULONGLONG mask{};
+    if (node <= 0xFF && GetNumaNodeProcessorMask(static_cast<UCHAR>(node), &mask))
+    {
+        for (size_t cpu = 0; cpu < 64; ++cpu)
+        {
+            if (mask & (ULONGLONG{ 1 } << cpu))
+                cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+#elif defined __linux__
+    auto cpus = ReadList("/sys/devices/system/node/node" + std::to_string(node) + "/cpulist");
+    if (cpus.empty() && node == 0)
+    {
+        /*no sysfs node information, so it is one node with every core*/
+        for (size_t cpu = 0; cpu < std::thread::hardware_concurrency(); ++cpu)
+            cpus.push_back(cpu);
+    }
+    return cpus;
+#else
+    (void)node;
+    return {};
+#endif
+}
+
+/*the cores the calling thread may run on, empty when unknown*/
+static std::vector<size_t> GetAffinity()
+{
+    std::vector<size_t> cpus;
+#ifdef _WIN32
+    /*there is no getter for the thread affinity, so set it to the process affinity and put it back*/
+    DWORD_PTR processMask{};
+    DWORD_PTR systemMask{};
+    if (GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask))
+    {
+        auto const threadMask = SetThreadAffinityMask(GetCurrentThread(), processMask);
+        if (threadMask != 0)
+        {
+            SetThreadAffinityMask(GetCurrentThread(), threadMask);
+            for (size_t cpu = 0; cpu < sizeof(DWORD_PTR) * 8; ++cpu)
+            {
+                if (threadMask & (DWORD_PTR{ 1 } << cpu))
+                    cpus.push_back(cpu);
+            }
+        }
+    }
+#elif defined __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    if (sched_getaffinity(0, sizeof(set), &set) == 0)
+    {
+        for (size_t cpu = 0; cpu < CPU_SETSIZE; ++cpu)
+        {
+            if (CPU_ISSET(cpu, &set))
+                cpus.push_back(cpu);
+        }
+    }
+#endif
+    return cpus;
+}
+
+/*restrict the calling thread to [cpus], false when not supported*/
+static bool SetAffinity(std::vector<size_t> const& cpus)
+{
+    if (cpus.empty())
+        return false;
+#ifdef _WIN32
+    DWORD_PTR mask{};
+    for (auto const cpu : cpus)
+    {
+        if (cpu < sizeof(DWORD_PTR) * 8)
+            mask |= DWORD_PTR{ 1 } << cpu;
+    }
+    return mask != 0 && SetThreadAffinityMask(GetCurrentThread(), mask) != 0;
+#elif defined __linux__
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    for (auto const cpu : cpus)
+    {
+        if (cpu < CPU_SETSIZE)
+            CPU_SET(cpu, &set);
+    }
+    return sched_setaffinity(0, sizeof(set), &set) == 0;
+#else
+    return false;
+#endif
+}
+
+NodeAffinity::NodeAffinity(size_t node)
+    : previous{ GetAffinity() }
+{
+    pinned = !previous.empty() && SetAffinity(NumaNodeCpus(node));
+}
+
+NodeAffinity::~NodeAffinity()
+{
+    if (pinned)
+        SetAffinity(previous);
+}
+
+void* AllocOnNode(size_t bytes, size_t node, PageKind kind)
+{
+    auto const ptr = PageAlloc(bytes, kind);
+#if defined __linux__ && defined SYS_mbind
+    /*MPOL_BIND before the first touch, so the pages land on the node even if the touching thread can not be pinned*/
+    constexpr int mpolBind = 2;
+    constexpr size_t bits = sizeof(unsigned long) * 8;
+    std::vector<unsigned long> mask(node / bits + 1);
+    mask[node / bits] |= 1ul << (node % bits);
+    syscall(SYS_mbind, ptr, bytes, mpolBind, mask.data(), mask.size() * bits + 1, 0);     //the kernel takes one more than the bits, like libnuma passes
+#endif
+    std::thread{ [&]
+    {
+        NodeAffinity const affinity{ node };
+        std::memset(ptr, 0, bytes);
+    } }.join();
+    return ptr;
+}
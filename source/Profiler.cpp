@@ -0,0 +1,109 @@
+#include "Profiler.h"
+#include <algorithm>
+#include <iomanip>
+
+void Profiler::record(cl::Event const& event, Operation operation, size_t bytes, std::string name, cl::NDRange const& global, cl::NDRange const& local)
+{
+    if (!isEnabled() || event() == nullptr)
+        return;
+
+    std::lock_guard lock{ mutex };
+    pending.push_back({ event, Record{ operation, std::move(name), bytes, global, local } });
+}
+
+void Profiler::resolve()
+{
+    for (auto& [event, record] : pending)
+    {
+        event.wait();
+        record.queued = event.getProfilingInfo<CL_PROFILING_COMMAND_QUEUED>();
+        record.submit = event.getProfilingInfo<CL_PROFILING_COMMAND_SUBMIT>();
+        record.start = event.getProfilingInfo<CL_PROFILING_COMMAND_START>();
+        record.end = event.getProfilingInfo<CL_PROFILING_COMMAND_END>();
+        records.push_back(std::move(record));
+    }
+    pending.clear();
+}
+
+std::vector<Profiler::Record> Profiler::getRecords()
+{
+    std::lock_guard lock{ mutex };
+    resolve();
+    return records;
+}
+
+std::map<std::string, Profiler::Summary> Profiler::summarize()
+{
+    std::lock_guard lock{ mutex };
+    resolve();
+
+    std::map<std::string, Summary> summaries;
+    for (auto const& record : records)
+    {
+        std::string key = toString(record.operation);
+        if (!record.name.empty())
+            (key += ' ') += record.name;
+
+        auto& summary = summaries[key];
+        auto const execution = record.executionTime();
+        summary.minExecutionTime = summary.count == 0 ? execution : std::min(summary.minExecutionTime, execution);
+        summary.maxExecutionTime = std::max(summary.maxExecutionTime, execution);
+        ++summary.count;
+        summary.bytes += record.bytes;
+        summary.hostQueueTime += record.hostQueueTime();
+        summary.deviceQueueTime += record.deviceQueueTime();
+        summary.executionTime += execution;
+    }
+    return summaries;
+}
+
+void Profiler::print(std::ostream& os)
+{
+    auto const toUs = [](cl_ulong ns) { return ns / 1000.0; };
+    os << std::left << std::setw(32) << "Operation" << std::right
+        << std::setw(8) << "Count"
+        << std::setw(16) << "Host queue us"
+        << std::setw(16) << "Device queue us"
+        << std::setw(16) << "Execution us"
+        << std::setw(16) << "Min us"
+        << std::setw(16) << "Max us"
+        << std::setw(12) << "MB/s" << '\n';
+    for (auto const& [operation, summary] : summarize())
+    {
+        os << std::left << std::setw(32) << operation << std::right
+            << std::setw(8) << summary.count
+            << std::setw(16) << toUs(summary.hostQueueTime)
+            << std::setw(16) << toUs(summary.deviceQueueTime)
+            << std::setw(16) << toUs(summary.executionTime)
+            << std::setw(16) << toUs(summary.minExecutionTime)
+            << std::setw(16) << toUs(summary.maxExecutionTime);
+        if (summary.bytes != 0 && summary.executionTime != 0)
+            os << std::setw(12) << (summary.bytes / 1024.0 / 1024.0) / (summary.executionTime / 1e9);
+        os << '\n';
+    }
+}
+
+void Profiler::clear()
+{
+    std::lock_guard lock{ mutex };
+    pending.clear();
+    records.clear();
+}
+
+const char* Profiler::toString(Operation operation)
+{
+    switch (operation)
+    {
+    case Operation::Kernel:
+        return "Kernel";
+    case Operation::Write:
+        return "Write";
+    case Operation::Read:
+        return "Read";
+    case Operation::Map:
+        return "Map";
+    case Operation::Copy:
+        return "Copy";
+    }
+    return "Unknown";
+}
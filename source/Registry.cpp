@@ -0,0 +1,205 @@
+#include "Registry.h"
+#include "Error.hpp"
+#include "GPU.h"
+#include "Report.h"
+#include "SizeLiteral.hpp"
+#include <algorithm>
+#include <cctype>
+#include <iostream>
+
+Registry::Selection Registry::Selection::group(std::string const& group)
+{
+    Selection selection;
+    selection.filter = std::regex{ '^' + group + '/' };
+    return selection;
+}
+
+Registry& Registry::add(std::string group, std::string name, std::string parameter, std::vector<size_t> sizes, std::function<void(size_t)> run, bool optional)
+{
+    return add(std::move(group), std::move(name), std::move(parameter), Sizes{ [sizes = std::move(sizes)] { return sizes; } }, std::move(run), optional);
+}
+
+Registry& Registry::add(std::string group, std::string name, std::string parameter, Sizes sizes, std::function<void(size_t)> run, bool optional)
+{
+    entries.push_back(Entry{ std::move(group), std::move(name), std::move(parameter), std::move(sizes), std::move(run), optional });
+    return *this;
+}
+
+Registry& Registry::add(std::string group, std::string name, std::function<void()> run, bool optional)
+{
+    return add(std::move(group), std::move(name), {}, std::vector<size_t>{}, [run = std::move(run)](size_t) { run(); }, optional);
+}
+
+std::vector<Registry::Entry const*> Registry::select(Selection const& selection) const
+{
+    std::vector<Entry const*> selected;
+    for (auto const& entry : entries)
+    {
+        if (entry.optional && !selection.includeOptional)
+            continue;
+        if (std::regex_search(entry.fullName(), selection.filter))
+            selected.push_back(&entry);
+    }
+    return selected;
+}
+
+/*so the peaks in the memory report belong to one run*/
+static void ResetPeaks()
+{
+    gpu.getMemoryTracker().resetPeak();
+    ResetPeakRss();
+}
+
+size_t Registry::run(Selection const& selection) const
+{
+    auto const selected = select(selection);
+    std::string const device = gpu.getDevice().getInfo<CL_DEVICE_NAME>().c_str();     //some drivers count the terminating null in the name
+    reporter.setMemorySource([] { return gpu.getMemoryReport(); });
+    std::string const* group{};
+    for (auto const entry : selected)
+    {
+        if (!group || *group != entry->group)
+        {
+            group = &entry->group;
+            std::cout << "\n///////////" << *group << "///////////\n";
+        }
+
+        if (!entry->parameterized())
+        {
+            reporter.begin(entry->fullName(), entry->parameter, 0, device);
+            try {
+                gpu.finish();
+                ResetPeaks();
+                entry->run(0);
+                gpu.getMemoryReport().print(std::cout);
+            }
+            catch (cl::Error const& err)
+            {
+                std::cerr << entry->fullName() << " failed:";
+                PrintCLError(err);
+            }
+            catch (...)
+            {
+                std::cerr << entry->fullName() << " failed\n";
+            }
+            continue;
+        }
+
+        auto const sizes = selection.sizes.empty() ? entry->sizes() : selection.sizes;
+        for (auto const size : sizes)
+        {
+            reporter.begin(entry->fullName(), entry->parameter, size, device);
+            try {
+                gpu.finish();
+                ResetPeaks();
+                entry->run(size);
+                gpu.getMemoryReport().print(std::cout);
+            }
+            catch (cl::Error const& err)
+            {
+                std::cerr << entry->fullName() << " failed at " << size << ", skipping the larger sizes:";
+                PrintCLError(err);
+                break;
+            }
+            catch (...)
+            {
+                std::cerr << entry->fullName() << " failed at " << size << ", skipping the larger sizes\n";
+                break;
+            }
+        }
+    }
+    try {
+        gpu.finish();
+    }
+    catch (...) {}
+    return selected.size();
+}
+
+void Registry::list(std::ostream& os, Selection const& selection) const
+{
+    for (auto const entry : select(selection))
+    {
+        os << entry->fullName();
+        if (entry->optional)
+            os << " (optional)";
+        if (entry->parameterized())
+        {
+            os << "  " << entry->parameter << ':';
+            for (auto const size : entry->sizes())
+                os << ' ' << (entry->parameter == "bytes" ? formatSize(size) : std::to_string(size));
+        }
+        os << '\n';
+    }
+}
+
+static size_t parseSize(std::string item)
+{
+    std::transform(item.begin(), item.end(), item.begin(), [](unsigned char c) { return static_cast<char>(std::tolower(c)); });
+    size_t digits{};
+    while (digits < item.size() && std::isdigit(static_cast<unsigned char>(item[digits])))
+        ++digits;
+    if (digits == 0)
+        throw ValueError{};
+
+    auto const value = std::stoull(item.substr(0, digits));
+    auto const suffix = item.substr(digits);
+    if (suffix.empty())
+        return value;
+    if (suffix == "k" || suffix == "kb")
+        return value * 1_kb;
+    if (suffix == "m" || suffix == "mb")
+        return value * 1_mb;
+    if (suffix == "g" || suffix == "gb")
+        return value * 1_gb;
+    throw ValueError{};
+}
+
+std::vector<size_t> Registry::parseSizes(std::string const& spec)
+{
+    std::vector<size_t> sizes;
+    size_t begin = 0;
+    while (begin < spec.size())
+    {
+        auto end = spec.find(',', begin);
+        if (end == std::string::npos)
+            end = spec.size();
+        auto const item = spec.substr(begin, end - begin);
+        begin = end + 1;
+
+        if (item.empty())
+            continue;
+        auto const dots = item.find("..");
+        if (dots == std::string::npos)
+        {
+            sizes.push_back(parseSize(item));
+            continue;
+        }
+
+        /*a range, doubling unless a *factor or +step is given*/
+        auto const stepAt = item.find_first_of("*+", dots + 2);
+        auto const first = parseSize(item.substr(0, dots));
+        auto const last = parseSize(item.substr(dots + 2, stepAt == std::string::npos ? std::string::npos : stepAt - dots - 2));
+        auto const multiply = stepAt == std::string::npos || item[stepAt] == '*';
+        auto const step = stepAt == std::string::npos ? 2 : parseSize(item.substr(stepAt + 1));
+        if (first == 0 || step == 0 || (multiply && step == 1) || first > last)
+            throw ValueError{};
+        for (auto size = first; size <= last; size = multiply ? size * step : size + step)
+        {
+            sizes.push_back(size);
+            if (multiply ? size > last / step : size > last - step)
+                break;
+        }
+    }
+    return sizes;
+}
+
+std::string Registry::formatSize(size_t size)
+{
+    if (size != 0 && size % 1_gb == 0)
+        return std::to_string(size / 1_gb) + "gb";
+    if (size != 0 && size % 1_mb == 0)
+        return std::to_string(size / 1_mb) + "mb";
+    if (size != 0 && size % 1_kb == 0)
+        return std::to_string(size / 1_kb) + "kb";
+    return std::to_string(size);
+}
@@ -0,0 +1,409 @@
+#include "Report.h"
+#include "Error.hpp"
+#include <cctype>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <sstream>
+#include <string_view>
+
+Reporter reporter;
+
+namespace
+{
+    /*the columns of both formats, in order*/
+    constexpr const char* columns[] = {
+        "benchmark", "parameter", "size", "variant", "device", "unit", "value",
+        "samples", "warmup", "min", "median", "mean", "p95", "p99", "stddev", "relativeError", "converged",
+        "rss", "peakRss", "deviceBytes", "devicePeakBytes", "memObjects", "kernels", "programs"
+    };
+
+    std::vector<std::string> Fields(Reporter::Record const& record)
+    {
+        auto const number = [](double value)
+        {
+            std::ostringstream os;
+            os << std::setprecision(std::numeric_limits<double>::max_digits10) << value;
+            return os.str();
+        };
+        auto const& stats = record.stats;
+        auto const& memory = record.memory;
+        return {
+            record.benchmark, record.parameter, std::to_string(record.size), record.variant, record.device, record.unit, number(record.value),
+            std::to_string(stats.samples), std::to_string(stats.warmup), number(stats.min), number(stats.median), number(stats.mean),
+            number(stats.p95), number(stats.p99), number(stats.stddev), number(stats.relativeError), stats.converged ? "true" : "false",
+            std::to_string(memory.rss), std::to_string(memory.peakRss), std::to_string(memory.deviceBytes), std::to_string(memory.devicePeakBytes),
+            std::to_string(memory.memObjects), std::to_string(memory.kernels), std::to_string(memory.programs)
+        };
+    }
+
+    /*the string columns, which are quoted in JSON*/
+    bool IsString(size_t column)
+    {
+        return column <= 5 && std::string_view{ columns[column] } != "size";
+    }
+
+    std::string JsonEscape(std::string const& s)
+    {
+        std::string escaped;
+        for (auto const c : s)
+        {
+            switch (c)
+            {
+            case '"': escaped += "\\\""; break;
+            case '\\': escaped += "\\\\"; break;
+            case '\n': escaped += "\\n"; break;
+            case '\t': escaped += "\\t"; break;
+            case '\r': escaped += "\\r"; break;
+            default:
+                if (static_cast<unsigned char>(c) < 0x20)
+                {
+                    std::ostringstream os;
+                    os << "\\u" << std::hex << std::setw(4) << std::setfill('0') << static_cast<int>(c);
+                    escaped += os.str();
+                }
+                else
+                    escaped += c;
+            }
+        }
+        return escaped;
+    }
+
+    std::string CsvEscape(std::string const& s)
+    {
+        if (s.find_first_of(",\"\n") == std::string::npos)
+            return s;
+        std::string escaped{ '"' };
+        for (auto const c : s)
+        {
+            if (c == '"')
+                escaped += '"';
+            escaped += c;
+        }
+        return escaped + '"';
+    }
+
+    using Object = std::map<std::string, std::string>;
+
+    /*a flat JSON object of strings, numbers and booleans, which is all openJsonLines() writes*/
+    Object ParseJsonObject(std::string const& line)
+    {
+        Object object;
+        size_t i{};
+        auto const skipSpace = [&] { while (i < line.size() && std::isspace(static_cast<unsigned char>(line[i]))) ++i; };
+        auto const expect = [&](char c)
+        {
+            skipSpace();
+            if (i >= line.size() || line[i] != c)
+                throw ValueError{};
+            ++i;
+        };
+        auto const parseString = [&]
+        {
+            expect('"');
+            std::string s;
+            while (i < line.size() && line[i] != '"')
+            {
+                if (line[i] == '\\' && i + 1 < line.size())
+                {
+                    ++i;
+                    switch (line[i])
+                    {
+                    case 'n': s += '\n'; break;
+                    case 't': s += '\t'; break;
+                    case 'r': s += '\r'; break;
+                    case 'u':
+                        if (i + 4 >= line.size())
+                            throw ValueError{};
+                        s += static_cast<char>(std::stoi(line.substr(i + 1, 4), nullptr, 16));
+                        i += 4;
+                        break;
+                    default: s += line[i];
+                    }
+                }
+                else
+                    s += line[i];
+                ++i;
+            }
+            expect('"');
+            return s;
+        };
+
+        expect('{');
+        skipSpace();
+        if (i < line.size() && line[i] == '}')
+            return object;
+        while (true)
+        {
+            auto key = parseString();
+            expect(':');
+            skipSpace();
+            std::string value;
+            if (i < line.size() && line[i] == '"')
+                value = parseString();
+            else
+            {
+                auto const end = line.find_first_of(",}", i);
+                if (end == std::string::npos)
+                    throw ValueError{};
+                value = line.substr(i, end - i);
+                while (!value.empty() && std::isspace(static_cast<unsigned char>(value.back())))
+                    value.pop_back();
+                i = end;
+            }
+            object[std::move(key)] = std::move(value);
+            skipSpace();
+            if (i < line.size() && line[i] == ',')
+            {
+                ++i;
+                continue;
+            }
+            expect('}');
+            return object;
+        }
+    }
+
+    std::vector<std::string> ParseCsvLine(std::string const& line)
+    {
+        std::vector<std::string> fields(1);
+        bool quoted{};
+        for (size_t i = 0; i < line.size(); ++i)
+        {
+            auto const c = line[i];
+            if (quoted)
+            {
+                if (c == '"' && i + 1 < line.size() && line[i + 1] == '"')
+                {
+                    fields.back() += '"';
+                    ++i;
+                }
+                else if (c == '"')
+                    quoted = false;
+                else
+                    fields.back() += c;
+            }
+            else if (c == '"')
+                quoted = true;
+            else if (c == ',')
+                fields.emplace_back();
+            else if (c != '\r')
+                fields.back() += c;
+        }
+        return fields;
+    }
+
+    Reporter::Record ToRecord(Object const& object)
+    {
+        auto const get = [&](const char* key) -> std::string
+        {
+            auto const iter = object.find(key);
+            return iter == object.end() ? std::string{} : iter->second;
+        };
+        auto const number = [&](const char* key) { auto const s = get(key); return s.empty() ? 0.0 : std::stod(s); };
+        auto const integer = [&](const char* key) { auto const s = get(key); return s.empty() ? size_t{} : static_cast<size_t>(std::stoull(s)); };
+
+        Reporter::Record record;
+        record.benchmark = get("benchmark");
+        if (record.benchmark.empty())
+            throw ValueError{};
+        record.parameter = get("parameter");
+        record.size = integer("size");
+        record.variant = get("variant");
+        record.device = get("device");
+        record.unit = get("unit");
+        record.value = number("value");
+        record.stats.samples = integer("samples");
+        record.stats.warmup = integer("warmup");
+        record.stats.min = number("min");
+        record.stats.median = number("median");
+        record.stats.mean = number("mean");
+        record.stats.p95 = number("p95");
+        record.stats.p99 = number("p99");
+        record.stats.stddev = number("stddev");
+        record.stats.relativeError = number("relativeError");
+        record.stats.converged = get("converged") == "true";
+        record.memory.rss = integer("rss");
+        record.memory.peakRss = integer("peakRss");
+        record.memory.deviceBytes = integer("deviceBytes");
+        record.memory.devicePeakBytes = integer("devicePeakBytes");
+        record.memory.memObjects = integer("memObjects");
+        record.memory.kernels = integer("kernels");
+        record.memory.programs = integer("programs");
+        return record;
+    }
+}
+
+std::string Reporter::Record::key() const
+{
+    auto key = benchmark;
+    if (!parameter.empty())
+        key += ' ' + parameter + '=' + std::to_string(size);
+    if (!variant.empty())
+        key += ' ' + variant;
+    return key + " [" + unit + "] on " + device;
+}
+
+void Reporter::begin(std::string benchmark, std::string parameter, size_t size, std::string device)
+{
+    this->benchmark = std::move(benchmark);
+    this->parameter = std::move(parameter);
+    this->size = size;
+    this->device = std::move(device);
+}
+
+void Reporter::report(Statistics const& stats, long double amount, const char* unit, std::string variant)
+{
+    stats.print(std::cout, amount, unit);
+    if (hostBandwidth > 0)
+    {
+        auto const unitBytes = std::string_view{ unit } == "MB/s" ? 1024.0 * 1024 : std::string_view{ unit } == "GB/s" ? 1024.0 * 1024 * 1024 : 0.0;
+        if (unitBytes > 0)
+        {
+            auto const flags = std::cout.flags();
+            auto const precision = std::cout.precision();
+            std::cout << "  = " << std::fixed << std::setprecision(1) << stats.perSec(amount) * unitBytes / hostBandwidth * 100 << "% of host bandwidth\n";
+            std::cout.flags(flags);
+            std::cout.precision(precision);
+        }
+    }
+    add(Record{ benchmark, parameter, size, std::move(variant), device, unit, static_cast<double>(stats.perSec(amount)), stats, {} });
+}
+
+void Reporter::report(long double value, const char* unit, std::string variant)
+{
+    add(Record{ benchmark, parameter, size, std::move(variant), device, unit, static_cast<double>(value), {}, {} });
+}
+
+void Reporter::add(Record record)
+{
+    if (memorySource)
+        record.memory = memorySource();
+    auto const fields = Fields(record);
+    if (jsonLines.is_open())
+    {
+        jsonLines << '{';
+        for (size_t column = 0; column < fields.size(); ++column)
+        {
+            jsonLines << (column == 0 ? "" : ",") << '"' << columns[column] << "\":";
+            if (IsString(column))
+                jsonLines << '"' << JsonEscape(fields[column]) << '"';
+            else
+                jsonLines << fields[column];
+        }
+        jsonLines << "}\n" << std::flush;
+    }
+    if (csv.is_open())
+    {
+        for (size_t column = 0; column < fields.size(); ++column)
+            csv << (column == 0 ? "" : ",") << CsvEscape(fields[column]);
+        csv << '\n' << std::flush;
+    }
+    records.push_back(std::move(record));
+}
+
+void Reporter::openJsonLines(std::string const& path)
+{
+    jsonLines.open(path, std::ios::app);
+    if (!jsonLines)
+        throw ValueError{};
+}
+
+void Reporter::openCsv(std::string const& path)
+{
+    csv.open(path, std::ios::app);
+    if (!csv)
+        throw ValueError{};
+    csv.seekp(0, std::ios::end);
+    if (csv.tellp() == 0)
+    {
+        for (size_t column = 0; column < std::size(columns); ++column)
+            csv << (column == 0 ? "" : ",") << columns[column];
+        csv << '\n';
+    }
+}
+
+std::vector<Reporter::Record> Reporter::load(std::string const& path)
+{
+    std::ifstream file{ path };
+    if (!file)
+        throw ValueError{};
+
+    auto const isCsv = path.size() >= 4 && path.compare(path.size() - 4, 4, ".csv") == 0;
+    std::vector<Record> loaded;
+    std::vector<std::string> header;
+    std::string line;
+    while (std::getline(file, line))
+    {
+        if (line.empty() || line == "\r")
+            continue;
+        if (!isCsv)
+        {
+            loaded.push_back(ToRecord(ParseJsonObject(line)));
+            continue;
+        }
+
+        auto fields = ParseCsvLine(line);
+        if (header.empty())
+        {
+            header = std::move(fields);
+            continue;
+        }
+        Object object;
+        for (size_t column = 0; column < header.size() && column < fields.size(); ++column)
+            object[header[column]] = std::move(fields[column]);
+        loaded.push_back(ToRecord(object));
+    }
+    return loaded;
+}
+
+std::vector<Reporter::Regression> Reporter::compare(std::vector<Record> const& baseline, std::vector<Record> const& current, double threshold)
+{
+    std::map<std::string, Record const*> baselineByKey;
+    for (auto const& record : baseline)
+        baselineByKey[record.key()] = &record;
+    std::map<std::string, Record const*> currentByKey;
+    for (auto const& record : current)
+        currentByKey[record.key()] = &record;
+
+    std::vector<Regression> regressions;
+    for (auto const& [key, record] : currentByKey)
+    {
+        auto const iter = baselineByKey.find(key);
+        if (iter == baselineByKey.end() || iter->second->value <= 0)
+            continue;
+        auto const change = record->value / iter->second->value - 1;
+        if (change < -threshold)
+            regressions.push_back(Regression{ *iter->second, *record, change });
+    }
+    return regressions;
+}
+
+size_t Reporter::printComparison(std::ostream& os, std::vector<Record> const& baseline, std::vector<Record> const& current, double threshold)
+{
+    std::map<std::string, Record const*> baselineByKey;
+    for (auto const& record : baseline)
+        baselineByKey[record.key()] = &record;
+
+    size_t compared{};
+    auto const flags = os.flags();
+    os << std::fixed << std::setprecision(1);
+    for (auto const& record : current)
+    {
+        auto const iter = baselineByKey.find(record.key());
+        if (iter == baselineByKey.end() || iter->second->value <= 0)
+            continue;
+        ++compared;
+        auto const change = record.value / iter->second->value - 1;
+        os << record.key() << ": " << iter->second->value << " -> " << record.value << " (" << std::showpos << change * 100 << std::noshowpos << "%)"
+            << (change < -threshold ? " REGRESSION" : "") << '\n';
+    }
+
+    auto const regressions = compare(baseline, current, threshold);
+    os << "\nCompared " << compared << " of " << current.size() << " results against the baseline, "
+        << regressions.size() << " slower by more than " << threshold * 100 << "%\n";
+    for (auto const& regression : regressions)
+        os << "  " << regression.current.key() << ' ' << regression.change * 100 << "%\n";
+    os.flags(flags);
+    return regressions.size();
+}
@@ -0,0 +1,68 @@
+#include "StagingRing.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include "Error.hpp"
+
+StagingRing::StagingRing(cl::Context const& context, cl::CommandQueue& queue, size_t chunkBytes, size_t chunkCount)
+    : queue{ queue },
+    chunkBytes{ chunkBytes }
+{
+    if (chunkBytes == 0 || chunkCount == 0)
+        throw ValueError{};
+
+    chunks.reserve(chunkCount);
+    for (size_t i = 0; i < chunkCount; ++i)
+    {
+        cl::Buffer buffer{ context, CL_MEM_READ_ONLY | CL_MEM_ALLOC_HOST_PTR, chunkBytes };
+        auto const host = queue.enqueueMapBuffer(buffer, true, CL_MAP_WRITE, 0, chunkBytes);
+        chunks.push_back({ std::move(buffer), host, cl::Event{} });
+    }
+}
+
+StagingRing::~StagingRing()
+{
+    try {
+        wait();
+        for (auto& chunk : chunks)
+            queue.enqueueUnmapMemObject(chunk.buffer, chunk.host);
+        queue.finish();
+    }
+    catch (cl::Error const& e) {
+        std::cerr << "An error happens in releasing the staging buffers. Code " << e.err() << ':' << e.what() << '\n';
+    }
+}
+
+void StagingRing::write(cl::Buffer const& dst, void const* src, size_t bytes, size_t dstOffset, cl::Event* event)
+{
+    auto const source = static_cast<char const*>(src);
+    for (size_t offset = 0; offset < bytes; offset += chunkBytes)
+    {
+        auto& chunk = chunks[next];
+        next = (next + 1) % chunks.size();
+
+        /*the DMA from this chunk must be done before it is overwritten*/
+        if (chunk.uploaded() != nullptr)
+            chunk.uploaded.wait();
+
+        auto const size = std::min(chunkBytes, bytes - offset);
+        std::memcpy(chunk.host, source + offset, size);
+        queue.enqueueWriteBuffer(dst, false, dstOffset + offset, size, chunk.host, nullptr, &chunk.uploaded);
+        queue.flush();  //start the DMA while the next chunk is being copied
+    }
+
+    if (event != nullptr && bytes != 0)
+        *event = chunks[(next + chunks.size() - 1) % chunks.size()].uploaded;
+}
+
+void StagingRing::wait()
+{
+    for (auto& chunk : chunks)
+    {
+        if (chunk.uploaded() != nullptr)
+        {
+            chunk.uploaded.wait();
+            chunk.uploaded = cl::Event{};
+        }
+    }
+}
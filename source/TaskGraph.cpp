@@ -0,0 +1,97 @@
+#include "TaskGraph.h"
+#include <algorithm>
+
+TaskGraph::Node TaskGraph::record(Enqueue enqueue, Dependencies dependencies, Profiled profiled)
+{
+    Node const node = tasks.size();
+    for (auto dependency : dependencies)
+    {
+        if (dependency >= node)     //only the recorded nodes can be depended on, which also rules out cycles
+            throw ValueError{};
+    }
+    tasks.push_back({ std::move(enqueue), { dependencies }, std::move(profiled) });
+    return node;
+}
+
+std::vector<cl::Event> const& TaskGraph::submit()
+{
+    events.assign(tasks.size(), cl::Event{});
+    if (device.supportsOutOfOrder())
+        submitOutOfOrder();
+    else
+        submitToStreams();
+
+    if (device.isProfiling())
+    {
+        for (Node node = 0; node < tasks.size(); ++node)
+        {
+            auto const& profiled = tasks[node].profiled;
+            device.getProfiler().record(events[node], profiled.operation, profiled.bytes, profiled.name, profiled.global, profiled.local);
+        }
+    }
+    return events;
+}
+
+void TaskGraph::submitOutOfOrder()
+{
+    auto& queue = device.getOutOfOrderQueue();
+    std::vector<cl::Event> waitList;
+    for (Node node = 0; node < tasks.size(); ++node)
+    {
+        waitList.clear();
+        for (auto dependency : tasks[node].dependencies)
+            waitList.push_back(events[dependency]);
+        tasks[node].enqueue(queue, waitList.empty() ? nullptr : &waitList, &events[node]);
+    }
+    queue.flush();
+}
+
+void TaskGraph::submitToStreams()
+{
+    auto const streamCount = device.getStreamCount();
+    std::vector<size_t> streamOf(tasks.size());
+    std::vector<Node> lastOfStream(streamCount, tasks.size());  //tasks.size() means the stream is still empty
+    size_t nextStream = 0;
+
+    std::vector<cl::Event> waitList;
+    for (Node node = 0; node < tasks.size(); ++node)
+    {
+        auto const& dependencies = tasks[node].dependencies;
+
+        /*continue the stream of a dependency if that dependency is the last thing in it, so the dependency is implied by the queue order*/
+        auto const chained = std::find_if(dependencies.cbegin(), dependencies.cend(), [&](Node dependency)
+        {
+            return lastOfStream[streamOf[dependency]] == dependency;
+        });
+        size_t stream{};
+        if (chained != dependencies.cend())
+            stream = streamOf[*chained];
+        else
+        {
+            stream = nextStream;
+            nextStream = (nextStream + 1) % streamCount;
+        }
+
+        waitList.clear();
+        for (auto dependency : dependencies)
+        {
+            if (streamOf[dependency] != stream)
+                waitList.push_back(events[dependency]);
+        }
+        tasks[node].enqueue(device.stream(stream), waitList.empty() ? nullptr : &waitList, &events[node]);
+        streamOf[node] = stream;
+        lastOfStream[stream] = node;
+    }
+
+    for (size_t stream = 0; stream < streamCount; ++stream)
+    {
+        if (lastOfStream[stream] != tasks.size())
+            device.stream(stream).flush();
+    }
+}
+
+void TaskGraph::wait() const
+{
+    if (!events.empty())
+        cl::Event::waitForEvents(events);
+}
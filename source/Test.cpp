@@ -1,7 +1,21 @@
 #include "Test.hpp"
 #include "GPU.h"
+#include "TaskGraph.h"
+#include "KernelLaunch.h"
+#include "StagingRing.h"
+#include "ThreadPool.h"
+#include "ThreadTeam.h"
+#include "GPUAllocator.h"
+#include "Numa.h"
+#include "Capacity.h"
+#include "LargeBuffer.h"
 #include "Timer.hpp"
+#include "Measure.h"
+#include "Registry.h"
+#include "Report.h"
 #include "SizeLiteral.hpp"
+#include <atomic>
+#include <cstring>
 #include <future>
 #include <iostream>
 #include <numeric>
@@ -63,6 +77,31 @@ namespace test
             //std::cout << n << '\n';
         }
 
+        void Streams()
+        {
+            using Benchmark::MatrixMultiplication::Matrix;
+            if (gpu.getStreamCount() < 3)
+                gpu.setStreamCount(3);
+
+            for (size_t size : { 128, 256, 512, 1024 })
+            {
+                Matrix m = Matrix::make_test_matrix(size, size);
+                Matrix n{ size, size };
+
+                auto buf = gpu.malloc<float, AccessMode::Read>(m.size());
+                auto result_buf = gpu.malloc<float, AccessMode::Write>(m.size());
+
+                /*upload in stream 1 -> transpose in stream 0 -> read back in stream 2*/
+                std::vector<cl::Event> uploaded(1), transposed(1);
+                buf.on(gpu.stream(1)).copyFrom(m.data, m.size(), false, nullptr, &uploaded[0]);
+                gpu.enqueueKernel(gpu.stream(0), gpu["Transpose"], std::make_tuple(buf.getClBuffer(), result_buf.getClBuffer()), {}, { size, size }, cl::NullRange, &uploaded, &transposed[0]);
+                result_buf.on(gpu.stream(2)).copyTo(n.data, n.size(), true, &transposed);
+
+                auto const expected = m.transpose();
+                std::cout << "Streams " << size << (std::equal(n.begin(), n.end(), expected.data) ? " passed\n" : " failed\n");
+            }
+        }
+
     }
 
     static void PrintFailureMessage(const char* msg, cl::Error const& err) noexcept
@@ -92,15 +131,15 @@ namespace test
             try {
 
                 std::cout << "Testing <CL_MEM_COPY_HOST_PTR> " << toMb(bytes) << " MB -> ";
-                auto const ptr = std::make_unique<char[]>(bytes);
+                auto const ptr = MakeHostBuffer<char>(bytes);
                 MakeData(ptr.get(), bytes);
 
-                Timer<false> t;
+                auto const stats = measure([&]
                 {
                     auto gpuBuffer = gpu.malloc<char, AccessMode::Read>(bytes, ptr.get());
                     //gpu.enqueueKernel(gpu["test"], std::make_tuple(gpuBuffer.getClBuffer(), bytes), { 0 }, { 1 });
-                }
-                std::cout << t.perSec(toMb(bytes)) << " MB/s\n";
+                });
+                reporter.report(stats, toMb(bytes), "MB/s");
             }
             catch (cl::Error const& err)
             {
@@ -118,16 +157,15 @@ namespace test
             try {
                 std::cout << "Testing <clEnqueueWriteBuffer> " << toMb(bytes) << " MB -> ";
                 auto gpuBuffer = gpu.malloc<char, AccessMode::Read>(bytes);
-                auto const ptr = std::make_unique<char[]>(bytes);
+                auto const ptr = MakeHostBuffer<char>(bytes);
                 MakeData(ptr.get(), bytes);
 
-                Timer<false> t;
+                auto const stats = measure([&]
                 {
-
                     gpuBuffer.copyFrom(ptr.get(), bytes, true);
                     //gpu.enqueueKernel(gpu["test"], std::make_tuple(gpuBuffer.getClBuffer(), bytes), { 0 }, { 1 });
-                }
-                std::cout << t.perSec(toMb(bytes)) << " MB/s\n";
+                });
+                reporter.report(stats, toMb(bytes), "MB/s");
             }
             catch (cl::Error const& err)
             {
@@ -136,6 +174,51 @@ namespace test
             }
         }
 
+        void WriteLargeBuffer(size_t bytes)
+        {
+            try {
+                std::cout << "Testing <clEnqueueWriteBuffer into LargeBuffer> " << toMb(bytes) << " MB -> ";
+                LargeBuffer<char> gpuBuffer{ gpu, bytes, AccessMode::Read };
+                auto const ptr = std::make_unique<char[]>(bytes);
+                MakeData(ptr.get(), bytes);
+
+                auto const stats = measure([&]
+                {
+                    gpuBuffer.copyFrom(ptr.get(), bytes, true);
+                });
+                std::cout << gpuBuffer.chunkCount() << " chunks, ";
+                reporter.report(stats, toMb(bytes), "MB/s");
+            }
+            catch (cl::Error const& err)
+            {
+                PrintFailureMessage("Testing <clEnqueueWriteBuffer into LargeBuffer> failed: ", err);
+                throw;
+            }
+        }
+
+        void WriteStagingRing(size_t bytes)
+        {
+            try {
+                std::cout << "Testing <staging ring> " << toMb(bytes) << " MB -> ";
+                auto gpuBuffer = gpu.malloc<char, AccessMode::Read>(bytes);
+                auto const ptr = std::make_unique<char[]>(bytes);
+                MakeData(ptr.get(), bytes);
+                StagingRing ring{ gpu.getCLContext(), gpu.getCLQueue() };
+
+                auto const stats = measure([&]
+                {
+                    ring.write(gpuBuffer, ptr.get(), bytes);
+                    ring.wait();
+                });
+                reporter.report(stats, toMb(bytes), "MB/s");
+            }
+            catch (cl::Error const& err)
+            {
+                PrintFailureMessage("Testing <staging ring> failed: ", err);
+                throw;
+            }
+        }
+
         void WriteBufferTotal(size_t bytes)
         {
             try {
@@ -143,12 +226,13 @@ namespace test
                 auto const ptr = std::make_unique<char[]>(bytes);
                 MakeData(ptr.get(), bytes);
 
-                Timer<false> t;
+                auto const stats = measure([&]
                 {
-                    auto gpuBuffer = gpu.malloc<char, AccessMode::Read>(bytes);
+                    /*not pooled, otherwise every sample after the warmup reuses a cached buffer and the allocation is not timed*/
+                    Buffer<char> gpuBuffer{ bytes, gpu.getCLContext(), gpu.getCLQueue(), AccessMode::Read };
                     gpuBuffer.copyFrom(ptr.get(), bytes, true);
-                }
-                std::cout << t.perSec(toMb(bytes)) << " MB/s\n";
+                });
+                reporter.report(stats, toMb(bytes), "MB/s");
             }
             catch (cl::Error const& err)
             {
@@ -169,12 +253,12 @@ namespace test
                 auto const ptr = std::make_unique<char[]>(bytes);
                 MakeData(ptr.get(), bytes);
 
-                Timer<false> t;
+                auto const stats = measure([&]
                 {
                     auto mappedBuffer = gpuBuffer.map<AccessMode::Write>();
                     std::copy_n(ptr.get(), bytes, mappedBuffer.m_ptr);
-                }
-                std::cout << t.perSec(toMb(bytes)) << " MB/s\n";
+                });
+                reporter.report(stats, toMb(bytes), "MB/s");
             }
             catch (cl::Error const& err)
             {
@@ -191,13 +275,14 @@ namespace test
                 auto const ptr = std::make_unique<char[]>(bytes);
                 MakeData(ptr.get(), bytes);
 
-                Timer<false> t;
+                auto const stats = measure([&]
                 {
-                    auto gpuBuffer = gpu.malloc<char, AccessMode::Read>(bytes);
+                    /*not pooled, see WriteBufferTotal()*/
+                    Buffer<char> gpuBuffer{ bytes, gpu.getCLContext(), gpu.getCLQueue(), AccessMode::Read };
                     auto mappedBuffer = gpuBuffer.map<AccessMode::Write>();
                     std::copy_n(ptr.get(), bytes, mappedBuffer.m_ptr);
-                }
-                std::cout << t.perSec(toMb(bytes)) << " MB/s\n";
+                });
+                reporter.report(stats, toMb(bytes), "MB/s");
             }
             catch (cl::Error const& err)
             {
@@ -211,51 +296,7 @@ namespace test
          */
         void CopyToDevice()
         {
-#ifdef ANDROID
-            const auto testBytes = { 4_kb, 1_mb,32_mb, 512_mb, 1_gb, 2_gb };
-            const auto mapBytes = { 4_kb, 1_mb,32_mb, 512_mb, 1_gb, 2_gb };
-#else
-            const auto testBytes = { 4_kb, 1_mb,32_mb, 512_mb, 1_gb, 2_gb, 4_gb, 6_gb };
-            const auto mapBytes = { 4_kb, 1_mb,32_mb, 512_mb, 1_gb, 2_gb};
-#endif
-            try {
-                for (auto const bytes : testBytes)
-                {
-                    gpu.finish();
-                    CopyHostPtr(bytes);
-                }
-            }catch(...){}
-            try {
-                for (auto const bytes : testBytes)
-                {
-                    gpu.finish();
-                    WriteBuffer(bytes);
-                }
-            }catch(...){}
-            try {
-                for (auto const bytes : mapBytes)
-                {
-                    gpu.finish();
-                    WriteMapBuffer(bytes);
-                }
-            }catch(...){}
-            try {
-                for (auto const bytes : testBytes)
-                {
-                    gpu.finish();
-                    WriteBufferTotal(bytes);
-                }
-            }catch(...){}
-            try {
-                for (auto const bytes : mapBytes)
-                {
-                    gpu.finish();
-                    WriteMapBufferTotal(bytes);
-                }
-            }catch(...){}
-            try {
-                gpu.finish();
-            }catch(...){}
+            Benchmarks().run(Registry::Selection::group("CopyToDevice"));
         }
 
         /**
@@ -267,17 +308,17 @@ namespace test
             try {
                 std::cout << "Testing <clEnqueueReadBuffer> " << toMb(bytes) << " MB -> ";
                 auto gpuBuffer = gpu.malloc<char, AccessMode::Write>(bytes);
-                auto const ptr = std::make_unique<char[]>(bytes);
+                auto const ptr = MakeHostBuffer<char>(bytes);
                 /*generate dummy data*/
                 gpu.enqueueKernel(gpu["TestRead"], std::make_tuple(gpuBuffer.getClBuffer()), { 0 }, { bytes });
                 gpu.finish();
 
-                Timer <false> t;
+                auto const stats = measure([&]
                 {
                     gpuBuffer.copyTo(ptr.get(), bytes, true);
                     gpu.finish();
-                }
-                std::cout << t.perSec(toMb(bytes)) << " MB/s\n";
+                });
+                reporter.report(stats, toMb(bytes), "MB/s");
             }
             catch(cl::Error const& err)
             {
@@ -300,12 +341,12 @@ namespace test
                 gpu.enqueueKernel(gpu["TestRead"], std::make_tuple(gpuBuffer.getClBuffer()), { 0 }, { bytes });
                 gpu.finish();
 
-                Timer<false> t;
+                auto const stats = measure([&]
                 {
                     auto mappedBuffer = gpuBuffer.map<AccessMode::Read>();
                     std::copy_n(mappedBuffer.m_ptr, bytes, ptr.get());
-                }
-                std::cout << t.perSec(toMb(bytes)) << " MB/s\n";
+                });
+                reporter.report(stats, toMb(bytes), "MB/s");
             }
             catch(cl::Error const& err)
             {
@@ -314,37 +355,330 @@ namespace test
             }
         }
 
+        void ReadMapBufferAsync(size_t bytes)
+        {
+            try{
+                std::cout << "Testing <non-blocking clEnqueueMapBuffer> " << toMb(bytes) << " MB -> ";
+                auto gpuBuffer = gpu.malloc<char, AccessMode::Write>(bytes);
+                auto const ptr = std::make_unique<char[]>(bytes);
+                /*generate dummy data*/
+                gpu.enqueueKernel(gpu["TestRead"], std::make_tuple(gpuBuffer.getClBuffer()), { 0 }, { bytes });
+                gpu.finish();
+
+                auto const stats = measure([&]
+                {
+                    /*all the slices are mapped before the first one is copied, so the copies overlap the remaining maps*/
+                    constexpr size_t slices = 4;
+                    auto const sliceBytes = (bytes + slices - 1) / slices;
+                    std::vector<MappedBuffer<char, AccessMode::Read>> mapped;
+                    mapped.reserve(slices);
+                    for (size_t offset = 0; offset < bytes; offset += sliceBytes)
+                        mapped.push_back(gpuBuffer.mapAsync<AccessMode::Read>(offset, std::min(sliceBytes, bytes - offset)));
+                    gpu.getCLQueue().flush();
+
+                    size_t offset{};
+                    for (auto& slice : mapped)
+                    {
+                        std::copy_n(slice.wait().m_ptr, slice.size(), ptr.get() + offset);
+                        offset += slice.size();
+                        slice.unmap();
+                    }
+                });
+                reporter.report(stats, toMb(bytes), "MB/s");
+            }
+            catch(cl::Error const& err)
+            {
+                PrintFailureMessage("Testing <non-blocking clEnqueueMapBuffer> failed: ", err);
+                throw;
+            }
+        }
+
         void CopyToHost()
         {
-#ifdef ANDROID
-            const auto testBytes = { 4_kb, 1_mb,32_mb, 512_mb, 768_mb };
-            const auto mapBytes = { 4_kb, 1_mb,32_mb, 512_mb, 768_mb };
-#else
-            const auto testBytes = { 4_kb, 1_mb,32_mb, 512_mb, 1_gb, 2_gb }; //NVIDIA 1660Super does not go over 2GB ReadBuffer
-            const auto mapBytes = { 4_kb, 1_mb,32_mb, 512_mb, 1_gb, 2_gb };
-#endif
+            Benchmarks().run(Registry::Selection::group("CopyToHost"));
+        }
+
+        using Benchmark::MatrixMultiplication::Matrix;
+
+        /*the tiles are cut from the middle of a matrix this large, so every row of a tile is strided*/
+        constexpr size_t tileSourceSize = 8192;
+
+        static auto TileOrigin(size_t tile)
+        {
+            return (tileSourceSize - std::min(tile, tileSourceSize)) / 2;
+        }
+
+        void WriteTileRect(size_t tile)
+        {
+            try {
+                auto const bytes = sizeof(float) * tile * tile;
+                std::cout << "Testing <clEnqueueWriteBufferRect> " << tile << 'x' << tile << " tile, " << toMb(bytes) << " MB -> ";
+                Matrix const host{ tileSourceSize, tileSourceSize, 1.0f };
+                auto gpuBuffer = gpu.malloc<float, AccessMode::Read>(tile * tile);
+                auto const origin = TileOrigin(tile);
+
+                auto const stats = measure([&]
+                {
+                    gpuBuffer.copyFromRect(host.data, host.layout(origin, origin), Matrix::extent(tile, tile), {}, true);
+                });
+                reporter.report(stats, toMb(bytes), "MB/s");
+            }
+            catch (cl::Error const& err)
+            {
+                PrintFailureMessage("Testing <clEnqueueWriteBufferRect> failed: ", err);
+                throw;
+            }
+        }
+
+        void WriteTilePacked(size_t tile)
+        {
+            try {
+                auto const bytes = sizeof(float) * tile * tile;
+                std::cout << "Testing <pack + clEnqueueWriteBuffer> " << tile << 'x' << tile << " tile, " << toMb(bytes) << " MB -> ";
+                Matrix const host{ tileSourceSize, tileSourceSize, 1.0f };
+                auto gpuBuffer = gpu.malloc<float, AccessMode::Read>(tile * tile);
+                auto const packed = std::make_unique<float[]>(tile * tile);
+                auto const origin = TileOrigin(tile);
+
+                auto const stats = measure([&]
+                {
+                    for (size_t row = 0; row < tile; ++row)
+                        std::copy_n(&host(origin + row, origin), tile, packed.get() + row * tile);
+                    gpuBuffer.copyFrom(packed.get(), tile * tile, true);
+                });
+                reporter.report(stats, toMb(bytes), "MB/s");
+            }
+            catch (cl::Error const& err)
+            {
+                PrintFailureMessage("Testing <pack + clEnqueueWriteBuffer> failed: ", err);
+                throw;
+            }
+        }
+
+        void ReadTileRect(size_t tile)
+        {
+            try {
+                auto const bytes = sizeof(float) * tile * tile;
+                std::cout << "Testing <clEnqueueReadBufferRect> " << tile << 'x' << tile << " tile, " << toMb(bytes) << " MB -> ";
+                Matrix host{ tileSourceSize, tileSourceSize };
+                auto gpuBuffer = gpu.malloc<float, AccessMode::Write>(tile * tile);
+                std::vector<float> const data(tile * tile, 1.0f);
+                gpuBuffer.copyFrom(data.data(), data.size(), true);
+                auto const origin = TileOrigin(tile);
+
+                auto const stats = measure([&]
+                {
+                    gpuBuffer.copyToRect(host.data, host.layout(origin, origin), Matrix::extent(tile, tile), {}, true);
+                });
+                reporter.report(stats, toMb(bytes), "MB/s");
+            }
+            catch (cl::Error const& err)
+            {
+                PrintFailureMessage("Testing <clEnqueueReadBufferRect> failed: ", err);
+                throw;
+            }
+        }
 
+        void ReadTilePacked(size_t tile)
+        {
             try {
-                for (auto const bytes : testBytes)
+                auto const bytes = sizeof(float) * tile * tile;
+                std::cout << "Testing <clEnqueueReadBuffer + unpack> " << tile << 'x' << tile << " tile, " << toMb(bytes) << " MB -> ";
+                Matrix host{ tileSourceSize, tileSourceSize };
+                auto gpuBuffer = gpu.malloc<float, AccessMode::Write>(tile * tile);
+                std::vector<float> packed(tile * tile, 1.0f);
+                gpuBuffer.copyFrom(packed.data(), packed.size(), true);
+                auto const origin = TileOrigin(tile);
+
+                auto const stats = measure([&]
                 {
+                    gpuBuffer.copyTo(packed.data(), packed.size(), true);
+                    for (size_t row = 0; row < tile; ++row)
+                        std::copy_n(packed.data() + row * tile, tile, &host(origin + row, origin));
+                });
+                reporter.report(stats, toMb(bytes), "MB/s");
+            }
+            catch (cl::Error const& err)
+            {
+                PrintFailureMessage("Testing <clEnqueueReadBuffer + unpack> failed: ", err);
+                throw;
+            }
+        }
+
+        void RectTransfer()
+        {
+            Benchmarks().run(Registry::Selection::group("RectTransfer"));
+        }
+
+        void ZeroCopyWrite(size_t bytes)
+        {
+            try {
+                std::cout << "Testing <zero-copy write> " << toMb(bytes) << " MB\n";
+                auto const ptr = std::make_unique<char[]>(bytes);
+                MakeData(ptr.get(), bytes);
+
+                auto copied = gpu.malloc<char, AccessMode::Read>(bytes);
+                std::cout << "clEnqueueWriteBuffer -> ";
+                reporter.report(measure([&] { copied.copyFrom(ptr.get(), bytes, true); }), toMb(bytes), "MB/s", "copy");
+
+                /*the data is produced in the buffer directly, only making it visible to the device is timed*/
+                auto zeroCopy = gpu.mallocZeroCopy<char, AccessMode::Read>(bytes);
+                std::cout << (zeroCopy.isZeroCopy() ? "zero-copy" : "not zero-copy") << " map/unmap -> ";
+                reporter.report(measure([&]
+                {
+                    auto mapped = zeroCopy.map<AccessMode::Write>();
+                    MakeData(mapped.m_ptr, bytes);
+                    mapped.unmap();
                     gpu.finish();
-                    ReadBuffer(bytes);
-                }
+                }), toMb(bytes), "MB/s", "map");
+            }
+            catch (cl::Error const& err)
+            {
+                PrintFailureMessage("Testing <zero-copy write> failed: ", err);
+                throw;
             }
-            catch(...)
-            {}
+        }
+
+        void ZeroCopyRead(size_t bytes)
+        {
             try {
-                for (auto const bytes : mapBytes)
+                std::cout << "Testing <zero-copy read> " << toMb(bytes) << " MB\n";
+                auto const ptr = std::make_unique<char[]>(bytes);
+
+                auto copied = gpu.malloc<char, AccessMode::Write>(bytes);
+                gpu.enqueueKernel(gpu["TestRead"], std::make_tuple(copied.getClBuffer()), { 0 }, { bytes });
+                std::cout << "clEnqueueReadBuffer -> ";
+                reporter.report(measure([&] { copied.copyTo(ptr.get(), bytes, true); }), toMb(bytes), "MB/s", "copy");
+
+                auto zeroCopy = gpu.mallocZeroCopy<char, AccessMode::Write>(bytes);
+                gpu.enqueueKernel(gpu["TestRead"], std::make_tuple(zeroCopy.getClBuffer()), { 0 }, { bytes });
+                gpu.finish();
+                std::cout << (zeroCopy.isZeroCopy() ? "zero-copy" : "not zero-copy") << " map/unmap -> ";
+                char sum{};
+                reporter.report(measure([&]
                 {
+                    auto mapped = zeroCopy.map<AccessMode::Read>();
+                    sum += mapped.m_ptr[0] + mapped.m_ptr[bytes - 1];
+                    mapped.unmap();
                     gpu.finish();
-                    ReadMapBuffer(bytes);
-                }
+                }), toMb(bytes), "MB/s", "map");
+#ifdef DEBUG
+                std::cout << "sum = " << static_cast<int>(sum) << '\n';
+#endif
             }
-            catch(...)
-            {}
+            catch (cl::Error const& err)
+            {
+                PrintFailureMessage("Testing <zero-copy read> failed: ", err);
+                throw;
+            }
+        }
+
+        void ZeroCopy()
+        {
+            Benchmarks().run(Registry::Selection::group("ZeroCopy"));
+        }
+
+        void DeviceCopy(size_t bytes)
+        {
             try {
+                std::cout << "Testing <device -> device copy> " << toMb(bytes) << " MB\n";
+                auto src = gpu.malloc<char, AccessMode::ReadWrite>(bytes);
+                auto dst = gpu.malloc<char, AccessMode::ReadWrite>(bytes);
+                gpu.enqueueKernel(gpu["TestRead"], std::make_tuple(src.getClBuffer()), { 0 }, { bytes });
                 gpu.finish();
-            } catch(...){}
+
+                std::cout << "clEnqueueCopyBuffer -> ";
+                reporter.report(measure([&] { src.copy(dst, bytes); gpu.finish(); }), toMb(bytes), "MB/s", "whole");
+
+                /*the second half of the source into the first half of the destination*/
+                auto const half = bytes / 2;
+                std::cout << "clEnqueueCopyBuffer of a sub-range -> ";
+                reporter.report(measure([&] { src.copy(dst, half, half, 0); gpu.finish(); }), toMb(half), "MB/s", "sub-range");
+
+                /*the middle half of every 4 KB row, packed into the destination*/
+                constexpr size_t rowBytes = 4096;
+                auto const rows = bytes / rowBytes;
+                if (rows != 0)
+                {
+                    std::cout << "clEnqueueCopyBufferRect -> ";
+                    RectExtent const extent{ rowBytes / 2, rows };
+                    reporter.report(measure([&]
+                    {
+                        src.copyRect(dst, { rowBytes / 4, 0, 0, rowBytes }, { 0, 0, 0, rowBytes / 2 }, extent);
+                        gpu.finish();
+                    }), toMb(extent.size()), "MB/s", "rect");
+                }
+
+                auto& kernel = gpu["CopyBuffer"];
+                std::cout << "copy kernel -> ";
+                reporter.report(measure([&]
+                {
+                    gpu.enqueueKernel(kernel, std::make_tuple(src.getClBuffer(), dst.getClBuffer()), { 0 }, { bytes / 16 });
+                    gpu.finish();
+                }), toMb(bytes / 16 * 16), "MB/s", "kernel");
+            }
+            catch (cl::Error const& err)
+            {
+                PrintFailureMessage("Testing <device -> device copy> failed: ", err);
+                throw;
+            }
+        }
+
+        template<size_t patternBytes>
+        struct Pattern
+        {
+            cl_uchar bytes[patternBytes];
+        };
+
+        template<size_t patternBytes>
+        static void FillWithPattern(Buffer<char>& buffer, size_t bytes)
+        {
+            Pattern<patternBytes> pattern{};
+            for (size_t i = 0; i < patternBytes; ++i)
+                pattern.bytes[i] = static_cast<cl_uchar>(i + 1);
+            auto const filled = bytes / patternBytes * patternBytes;
+            auto const variant = "pattern=" + std::to_string(patternBytes);
+
+            std::cout << patternBytes << " byte pattern, clEnqueueFillBuffer -> ";
+            reporter.report(measure([&] { buffer.fill(pattern, 0, filled); gpu.finish(); }), toMb(filled), "MB/s", variant);
+
+            /*the kernel writes whole uint4, so the pattern is repeated up to at least 16 bytes*/
+            constexpr size_t vectorBytes = std::max<size_t>(patternBytes, 16);
+            char repeated[vectorBytes];
+            for (size_t i = 0; i < vectorBytes; ++i)
+                repeated[i] = static_cast<char>(pattern.bytes[i % patternBytes]);
+            auto patternBuffer = gpu.malloc<char, AccessMode::Read>(vectorBytes, repeated);
+            auto& kernel = gpu["FillBuffer"];
+            auto const vectors = bytes / 16;
+
+            std::cout << patternBytes << " byte pattern, fill kernel -> ";
+            reporter.report(measure([&]
+            {
+                gpu.enqueueKernel(kernel, std::make_tuple(buffer.getClBuffer(), patternBuffer.getClBuffer(), static_cast<cl_uint>(vectorBytes / 16)), { 0 }, { vectors });
+                gpu.finish();
+            }), toMb(vectors * 16), "MB/s", "kernel " + variant);
+        }
+
+        void Fill(size_t bytes)
+        {
+            try {
+                std::cout << "Testing <fill> " << toMb(bytes) << " MB\n";
+                auto buffer = gpu.malloc<char, AccessMode::ReadWrite>(bytes);
+                FillWithPattern<1>(buffer, bytes);
+                FillWithPattern<4>(buffer, bytes);
+                FillWithPattern<16>(buffer, bytes);
+                FillWithPattern<128>(buffer, bytes);
+            }
+            catch (cl::Error const& err)
+            {
+                PrintFailureMessage("Testing <fill> failed: ", err);
+                throw;
+            }
+        }
+
+        void OnDevice()
+        {
+            Benchmarks().run(Registry::Selection::group("OnDevice"));
         }
 
         void MapReadWrite()
@@ -352,39 +686,380 @@ namespace test
             
         }
 
-        template<typename T>
-        [[maybe_unused]]T ReadAsType(size_t bytes)
+        void RamSpeed()
+        {
+            Benchmarks().run(Registry::Selection::group("HostBandwidth"));
+        }
+
+        void DataTransfer()
+        {
+            Registry::Selection selection;
+            selection.filter = std::regex{ "^CopyTo(Device|Host)/" };
+            Benchmarks().run(selection);
+        }
+
+    }
+
+    namespace Latency
+    {
+        /**
+         * @brief Report the latency of a transfer as transfers per second, whose printed distribution is the latency in microseconds
+         * @param enqueue Enqueues the transfer without blocking and returns the event that completes with it
+         * @param blocking Does the same transfer and returns after it has completed
+         */
+        template<typename Enqueue, typename Blocking>
+        static void MeasureLatency(Enqueue&& enqueue, Blocking&& blocking)
         {
-            std::cout << "Read RAM as type: " << typeid(T).name();
-            const auto count = bytes / sizeof(T);
-            auto ptr = std::make_unique<T[]>(count);
-            T result{};
+            std::cout << "  enqueue only -> ";
+            reporter.report(measure([&]
             {
-                Timer<false> t;
-#ifndef ANDROID
-                std::for_each_n(std::execution::par_unseq, ptr.get(), count, [](auto& element) {++element; });
+                Timer<false> const t;
+                auto const event = enqueue();
+                auto const time = t.getDuration();
+                event.wait();
+                return time;
+            }), 1, "ops/s", "enqueue");
+
+            std::cout << "  non-blocking to completion -> ";
+            reporter.report(measure([&]
+            {
+                enqueue().wait();
+            }), 1, "ops/s", "completion");
+
+            std::cout << "  blocking -> ";
+            reporter.report(measure([&]
+            {
+                blocking();
+            }), 1, "ops/s", "blocking");
+        }
+
+        void CopyHostPtr(size_t bytes)
+        {
+            std::cout << "Latency of <CL_MEM_COPY_HOST_PTR> " << bytes << " bytes -> ";
+            auto const ptr = std::make_unique<char[]>(bytes);
+
+            /*the copy happens on creation, so there is nothing to enqueue*/
+            reporter.report(measure([&]
+            {
+                auto gpuBuffer = gpu.malloc<char, AccessMode::Read>(bytes, ptr.get());
+            }), 1, "ops/s", "blocking");
+        }
+
+        void WriteBuffer(size_t bytes)
+        {
+            std::cout << "Latency of <clEnqueueWriteBuffer> " << bytes << " bytes\n";
+            auto gpuBuffer = gpu.malloc<char, AccessMode::Read>(bytes);
+            auto const ptr = std::make_unique<char[]>(bytes);
+
+            MeasureLatency(
+                [&]
+                {
+                    cl::Event event;
+                    gpuBuffer.copyFrom(ptr.get(), bytes, false, nullptr, &event);
+                    return event;
+                },
+                [&] { gpuBuffer.copyFrom(ptr.get(), bytes, true); });
+        }
+
+        void MapUnmap(size_t bytes)
+        {
+            std::cout << "Latency of <clEnqueueMapBuffer + clEnqueueUnmapMemObject> " << bytes << " bytes\n";
+            auto gpuBuffer = gpu.malloc<char, AccessMode::ReadWrite>(bytes);
+
+            /*the queue is in order, so the event of the unmap completes after both*/
+            MeasureLatency(
+                [&]
+                {
+                    auto mapped = gpuBuffer.mapAsync<AccessMode::ReadWrite>();
+                    return mapped.unmap();
+                },
+                [&]
+                {
+                    auto mapped = gpuBuffer.map<AccessMode::ReadWrite>();
+                    mapped.unmap().wait();
+                });
+        }
+
+        void ReadBuffer(size_t bytes)
+        {
+            std::cout << "Latency of <clEnqueueReadBuffer> " << bytes << " bytes\n";
+            auto gpuBuffer = gpu.malloc<char, AccessMode::Write>(bytes);
+            auto const ptr = std::make_unique<char[]>(bytes);
+
+            MeasureLatency(
+                [&]
+                {
+                    cl::Event event;
+                    gpuBuffer.copyTo(ptr.get(), bytes, false, nullptr, &event);
+                    return event;
+                },
+                [&] { gpuBuffer.copyTo(ptr.get(), bytes, true); });
+        }
+
+        void Latency()
+        {
+            Benchmarks().run(Registry::Selection::group("Latency"));
+        }
+    }
+
+    namespace Capacity
+    {
+        void Probe()
+        {
+            auto const queried = GetCapacity(gpu.getDevice());
+            std::cout << (queried.probed ? "Probed before: " : "Queried: ")
+                << "largest allocation " << toMb(queried.maxAllocation) << " MB, global memory " << toMb(queried.globalMemory) << " MB"
+                << (queried.unifiedMemory ? " (host memory)" : "")
+                << ", host RAM " << toMb(queried.hostRam) << " MB, " << toMb(queried.hostAvailable) << " MB available\n";
+            try {
+                /*the buffers cached by the pool would be counted as taken*/
+                gpu.finish();
+                gpu.getBufferPool().trim();
+                auto const limits = ProbeAllocationLimits(gpu.getCLContext(), gpu.getCLQueue(), gpu.getDevice(), 64_mb);
+                std::cout << "Probed: largest allocation " << toMb(limits.largestAllocation) << " MB, largest total " << toMb(limits.largestTotal) << " MB"
+                    << (limits.hostReserveReached ? ", stopped to keep the host reserve" : "") << '\n';
+                reporter.report(toMb(limits.largestAllocation), "MB", "allocation");
+                reporter.report(toMb(limits.largestTotal), "MB", "total");
+            }
+            catch (cl::Error const& err)
+            {
+                PrintFailureMessage("Probing the allocation limits failed: ", err);
+                throw;
+            }
+        }
+    }
+
+    namespace HostBandwidth
+    {
+        constexpr size_t elements = 1 << 24;    //3 arrays of 128 MB, far beyond the last level cache
+        constexpr double scalar = 3.0;
+
+        /*plain loops over restrict pointers, which the compilers vectorize*/
+        static void Copy(double const* __restrict a, double* __restrict c, size_t begin, size_t end)
+        {
+            for (auto i = begin; i < end; ++i)
+                c[i] = a[i];
+        }
+
+        static void Scale(double const* __restrict c, double* __restrict b, size_t begin, size_t end)
+        {
+            for (auto i = begin; i < end; ++i)
+                b[i] = scalar * c[i];
+        }
+
+        static void Add(double const* __restrict a, double const* __restrict b, double* __restrict c, size_t begin, size_t end)
+        {
+            for (auto i = begin; i < end; ++i)
+                c[i] = a[i] + b[i];
+        }
+
+        static void Triad(double const* __restrict b, double const* __restrict c, double* __restrict a, size_t begin, size_t end)
+        {
+            for (auto i = begin; i < end; ++i)
+                a[i] = b[i] + scalar * c[i];
+        }
+
+        static double Read(double const* __restrict a, size_t begin, size_t end)
+        {
+            /*independent partial sums, so the additions do not wait for each other*/
+            double sum[4]{};
+            auto i = begin;
+            for (; i + 4 <= end; i += 4)
+            {
+                sum[0] += a[i];
+                sum[1] += a[i + 1];
+                sum[2] += a[i + 2];
+                sum[3] += a[i + 3];
+            }
+            for (; i < end; ++i)
+                sum[0] += a[i];
+            return sum[0] + sum[1] + sum[2] + sum[3];
+        }
+
+        static void Write(double* __restrict a, size_t begin, size_t end)
+        {
+            for (auto i = begin; i < end; ++i)
+                a[i] = scalar;
+        }
+
+        void Stream(size_t threads)
+        {
+            std::cout << "Testing host memory bandwidth with " << threads << " threads\n";
+            ThreadTeam team{ threads };
+            if (!team.isPinned())
+                std::cout << "  (the threads are not pinned to cores)\n";
+
+            auto const a = MakeAligned<double>(elements, PageSize());
+            auto const b = MakeAligned<double>(elements, PageSize());
+            auto const c = MakeAligned<double>(elements, PageSize());
+            /*first touch: each thread initializes the part it works on later, so those pages are placed on its NUMA node*/
+            team.run([&](size_t index)
+            {
+                auto const [begin, end] = ThreadTeam::split(elements, index, threads);
+                std::fill(a.get() + begin, a.get() + end, 1.0);
+                std::fill(b.get() + begin, b.get() + end, 2.0);
+                std::fill(c.get() + begin, c.get() + end, 0.0);
+            });
+
+            double peak{};
+            auto const run = [&](const char* name, size_t bytesPerElement, auto&& kernel)
+            {
+                std::cout << "  " << name << " -> ";
+                auto const stats = measure([&]
+                {
+                    team.run([&](size_t index)
+                    {
+                        auto const [begin, end] = ThreadTeam::split(elements, index, threads);
+                        kernel(index, begin, end);
+                    });
+                });
+                auto const bytes = bytesPerElement * elements;
+                reporter.report(stats, toGb(bytes), "GB/s", name);
+                peak = std::max(peak, static_cast<double>(stats.perSec(bytes)));
+            };
+
+            /*the bytes moved per element as counted by STREAM, the write-allocate reads are not counted*/
+            run("copy", 2 * sizeof(double), [&](size_t, size_t begin, size_t end) { Copy(a.get(), c.get(), begin, end); });
+            run("scale", 2 * sizeof(double), [&](size_t, size_t begin, size_t end) { Scale(c.get(), b.get(), begin, end); });
+            run("add", 3 * sizeof(double), [&](size_t, size_t begin, size_t end) { Add(a.get(), b.get(), c.get(), begin, end); });
+            run("triad", 3 * sizeof(double), [&](size_t, size_t begin, size_t end) { Triad(b.get(), c.get(), a.get(), begin, end); });
+            std::vector<double> sums(threads);
+            run("read", sizeof(double), [&](size_t index, size_t begin, size_t end) { sums[index] = Read(a.get(), begin, end); });
+            run("write", sizeof(double), [&](size_t, size_t begin, size_t end) { Write(c.get(), begin, end); });
+#ifdef DEBUG
+            std::cout << "sum = " << std::accumulate(sums.begin(), sums.end(), 0.0) << '\n';
 #endif
-                std::cout << " Speed: " << toGb(t.perSec(bytes)) << " GB/s \n";
+
+            if (peak > reporter.getHostBandwidth())
+                reporter.setHostBandwidth(peak);
+        }
+    }
+
+    namespace HugePages
+    {
+        /**
+         * @brief For every page kind, report the first touch of a fresh host buffer and then [transfer] from/to a touched one
+         * @param transfer Measures the transfer with the host buffer it is given
+         */
+        template<typename Transfer>
+        static void ForEachPageKind(size_t bytes, Transfer&& transfer)
+        {
+            for (auto const kind : { PageKind::Small, PageKind::Transparent, PageKind::Huge })
+            {
+                auto const name = ToString(kind) + " pages";
+                try {
+                    /*a fresh buffer every sample, only its first touch is timed*/
+                    std::cout << "  " << name << ", first touch -> ";
+                    reporter.report(measure([&]
+                    {
+                        auto const host = MakePaged<char>(bytes, kind);
+                        Timer<false> const t;
+                        std::memset(host.get(), 1, bytes);
+                        return t.getDuration();
+                    }), toMb(bytes), "MB/s", name + " first touch");
+
+                    auto const host = MakePaged<char>(bytes, kind);
+                    std::memset(host.get(), 1, bytes);
+                    std::cout << "  " << name << " -> ";
+                    reporter.report(transfer(host.get()), toMb(bytes), "MB/s", name);
+                }
+                catch (NotImplementException const&)
+                {
+                    std::cout << "not supported on this platform\n";
+                }
+                catch (std::bad_alloc const&)
+                {
+                    std::cout << "not available (no huge pages reserved?)\n";
+                }
             }
-            return result;
         }
 
-        void RamSpeed()
+        void CopyHostPtr(size_t bytes)
         {
-            ReadAsType<unsigned char>(10_gb);
-            ReadAsType<unsigned short>(10_gb);
-            ReadAsType<unsigned int>(10_gb);
-            ReadAsType<unsigned long long>(10_gb);
+            std::cout << "Testing <CL_MEM_COPY_HOST_PTR> " << toMb(bytes) << " MB\n";
+            ForEachPageKind(bytes, [&](char* host)
+            {
+                return measure([&] { auto gpuBuffer = gpu.malloc<char, AccessMode::Read>(bytes, host); });
+            });
         }
 
-        void DataTransfer()
+        void WriteBuffer(size_t bytes)
         {
-            std::cout << "///////////Host -> Device///////////\n";
-            CopyToDevice();
-            std::cout << "\n\n////////////Device -> Host///////////\n";
-            CopyToHost();
+            std::cout << "Testing <clEnqueueWriteBuffer> " << toMb(bytes) << " MB\n";
+            auto gpuBuffer = gpu.malloc<char, AccessMode::Read>(bytes);
+            ForEachPageKind(bytes, [&](char* host)
+            {
+                return measure([&] { gpuBuffer.copyFrom(host, bytes, true); });
+            });
         }
 
+        void WriteMapBuffer(size_t bytes)
+        {
+            std::cout << "Testing <clEnqueueMapBuffer> write " << toMb(bytes) << " MB\n";
+            auto gpuBuffer = gpu.malloc<char, AccessMode::Read>(bytes);
+            ForEachPageKind(bytes, [&](char* host)
+            {
+                return measure([&]
+                {
+                    auto mapped = gpuBuffer.map<AccessMode::Write>();
+                    std::copy_n(host, bytes, mapped.m_ptr);
+                });
+            });
+        }
+
+        void ReadBuffer(size_t bytes)
+        {
+            std::cout << "Testing <clEnqueueReadBuffer> " << toMb(bytes) << " MB\n";
+            auto gpuBuffer = gpu.malloc<char, AccessMode::Write>(bytes);
+            gpu.enqueueKernel(gpu["TestRead"], std::make_tuple(gpuBuffer.getClBuffer()), { 0 }, { bytes });
+            gpu.finish();
+            ForEachPageKind(bytes, [&](char* host)
+            {
+                return measure([&] { gpuBuffer.copyTo(host, bytes, true); });
+            });
+        }
+
+        void ReadMapBuffer(size_t bytes)
+        {
+            std::cout << "Testing <clEnqueueMapBuffer> read " << toMb(bytes) << " MB\n";
+            auto gpuBuffer = gpu.malloc<char, AccessMode::Write>(bytes);
+            gpu.enqueueKernel(gpu["TestRead"], std::make_tuple(gpuBuffer.getClBuffer()), { 0 }, { bytes });
+            gpu.finish();
+            ForEachPageKind(bytes, [&](char* host)
+            {
+                return measure([&]
+                {
+                    auto mapped = gpuBuffer.map<AccessMode::Read>();
+                    std::copy_n(mapped.m_ptr, bytes, host);
+                });
+            });
+        }
+    }
+
+    namespace Numa
+    {
+        void Transfer(size_t bytes)
+        {
+            auto const nodes = NumaNodes();
+            std::cout << "Testing transfers of " << toMb(bytes) << " MB for every (buffer node, thread node) of " << nodes.size() << " NUMA nodes\n";
+            auto gpuBuffer = gpu.malloc<char, AccessMode::ReadWrite>(bytes);
+            for (auto const threadNode : nodes)
+            {
+                NodeAffinity const affinity{ threadNode };
+                if (!affinity.isPinned())
+                    std::cout << "  (the thread can not be pinned to node " << threadNode << ")\n";
+                for (auto const bufferNode : nodes)
+                {
+                    auto const host = MakeOnNode<char>(bytes, bufferNode);
+                    auto const variant = "buffer=" + std::to_string(bufferNode) + " thread=" + std::to_string(threadNode);
+
+                    std::cout << "  " << variant << " clEnqueueWriteBuffer -> ";
+                    reporter.report(measure([&] { gpuBuffer.copyFrom(host.get(), bytes, true); }), toMb(bytes), "MB/s", variant + " write");
+                    std::cout << "  " << variant << " clEnqueueReadBuffer -> ";
+                    reporter.report(measure([&] { gpuBuffer.copyTo(host.get(), bytes, true); }), toMb(bytes), "MB/s", variant + " read");
+                }
+            }
+        }
     }
 
     namespace Compilation
@@ -431,7 +1106,7 @@ namespace test
             "SumAll"
         };
 #endif
-        void SingleThread(bool saveKernel)
+        long double SingleThread(bool saveKernel)
         {
             std::cout << "Testing <CompileSingleThread> -> ";
 #ifdef ANDROID
@@ -448,7 +1123,10 @@ namespace test
 
                 ++count;
             }
-            std::cout << t.perSec(count) << " kernels /s\n";
+            auto const rate = t.perSec(count);
+            std::cout << rate << " kernels /s\n";
+            reporter.report(rate, "kernels/s", saveKernel ? "SingleThreadSaveBinary" : "SingleThread");
+            return rate;
 #else
 
             std::filesystem::directory_iterator dirIter{ "./test" };
@@ -468,7 +1146,10 @@ namespace test
                     ++count;
                 }
             }
-            std::cout << t.perSec(count) << " kernels /s\n";
+            auto const rate = t.perSec(count);
+            std::cout << rate << " kernels /s\n";
+            reporter.report(rate, "kernels/s", saveKernel ? "SingleThreadSaveBinary" : "SingleThread");
+            return rate;
 #endif
         }
 
@@ -478,7 +1159,7 @@ namespace test
 #ifdef ANDROID
             std::vector<std::future<void>> buildFutures;
             buildFutures.reserve(50);
-            int count{};
+            std::atomic<int> count{};
             Timer<true> t;
 
             for (auto path : dirIter)
@@ -495,7 +1176,7 @@ namespace test
 #else
             std::vector<std::future<void>> buildFutures;
             buildFutures.reserve(50);
-            int count{};
+            std::atomic<int> count{};
             Timer<true> t;
 
             std::filesystem::directory_iterator dirIter{ "./test" };
@@ -518,7 +1199,9 @@ namespace test
             /*wait for all futures to finish */
             for (auto& future : buildFutures)
                 future.wait();
-            std::cout << t.perSec(count) << " kernels /s\n";
+            auto const rate = t.perSec(count.load());
+            std::cout << rate << " kernels /s\n";
+            reporter.report(rate, "kernels/s", "MultiThreadWithAsync");
         }
 
         void MultiThreadWithThread()
@@ -527,7 +1210,7 @@ namespace test
 #ifdef ANDROID
             std::vector<std::thread> threads;
             threads.reserve(50);
-            int count{};
+            std::atomic<int> count{};
             Timer<true> t;
 
             for (auto path : dirIter)
@@ -544,7 +1227,7 @@ namespace test
 #else
             std::vector<std::thread> threads;
             threads.reserve(50);
-            int count{};
+            std::atomic<int> count{};
             Timer<true> t;
 
             std::filesystem::directory_iterator dirIter{ "./test" };
@@ -567,7 +1250,9 @@ namespace test
             /*wait for all threads to finish */
             for (auto& thread : threads)
                 thread.join();
-            std::cout << t.perSec(count) << " kernels /s\n";
+            auto const rate = t.perSec(count.load());
+            std::cout << rate << " kernels /s\n";
+            reporter.report(rate, "kernels/s", "MultiThreadWithThread");
         }
 
         void LoadFromBinary()
@@ -611,7 +1296,9 @@ namespace test
                 }
             }
 #endif
-            std::cout << "Loaded " << count << " kernels from binary "<< t.perSec(count)<<" kernels /s\n";
+            auto const rate = t.perSec(count);
+            std::cout << "Loaded " << count << " kernels from binary "<< rate <<" kernels /s\n";
+            reporter.report(rate, "kernels/s", "LoadFromBinary");
         }
 
         void MultiThreadLoadFromBinary()
@@ -621,9 +1308,9 @@ namespace test
 
 #ifdef ANDROID
             /*Then load the kernels*/
-            int count = {}; //reset count
+            std::atomic<int> count{};
             std::vector<std::future<void>> buildFutures;
-            buildFutures.reserve(count);
+            buildFutures.reserve(50);
             Timer<true> t;
 
 
@@ -643,9 +1330,9 @@ namespace test
             /*Then load the kernels*/
             std::cout << "Testing <LoadingBinaryMultiThread> -> ";
             std::filesystem::directory_iterator dirIter{ "./test" };    //reset dirIter
-            int count = {}; //reset count
+            std::atomic<int> count{};
             std::vector<std::future<void>> buildFutures;
-            buildFutures.reserve(count);
+            buildFutures.reserve(50);
             Timer<true> t;
 
 
@@ -660,89 +1347,164 @@ namespace test
         #ifdef _WIN32
                             std::wcout << "Kernel: <" << fpath.stem().c_str() << "> loaded\n";   //In Win32, the c_str() is a wchar_t string
         #else
-                            std::cout << "Kernel: <" << path.stem().c_str() << "> loaded\n";
+                            std::cout << "Kernel: <" << fpath.stem().c_str() << "> loaded\n";
         #endif
     #endif
                             ++count;
                         }));
                 }
             }
-#endif
+#endif
+
+            for (auto& future : buildFutures)
+                future.wait();
+
+            auto const rate = t.perSec(count.load());
+            std::cout << "Loaded " << count.load() << " kernels from binary " << rate << " kernels /s\n";
+            reporter.report(rate, "kernels/s", "MultiThreadLoadFromBinary");
+        }
+
+#ifndef ANDROID
+        void BuildPipeline(long double singleThreadRate)
+        {
+            std::cout << "Testing <CompilingThreadPool> -> ";
+            std::unordered_map<std::string, cl::Kernel> kernels;
+            /*the helper is compiled once and linked into every program, so the link stage really runs*/
+            std::vector<std::filesystem::path> const helpers{ "LinkHelper.cl" };
+            auto const stats = compiler.buildAll(kernels, { CompileOption::Optimize::FastMath }, { CompileOption::Std::CL2_0 }, "./test", helpers);
+
+            using FpSeconds = std::chrono::duration<long double>;
+            auto const rate = stats.programs / FpSeconds{ stats.total }.count();
+            std::cout << rate << " kernels /s with " << stats.threads << " threads and " << helpers.size() << " linked helper, "
+                << "compile: " << std::chrono::duration_cast<std::chrono::milliseconds>(stats.compile).count() << " ms, "
+                << "link: " << std::chrono::duration_cast<std::chrono::milliseconds>(stats.link).count() << " ms";
+            if (stats.failed != 0)
+                std::cout << ", " << stats.failed << " failed";
+            if (singleThreadRate > 0)
+                std::cout << ", " << rate / singleThreadRate << "x of <CompileSingleThread>";
+            std::cout << '\n';
+            reporter.report(rate, "kernels/s", "BuildPipeline");
+            if (stats.link.count() > 0)
+                reporter.report(stats.programs / FpSeconds{ stats.link }.count(), "links/s", "BuildPipeline");
+        }
+
+        void BinaryCache()
+        {
+            if (binaryCache.getDirectory().empty())
+            {
+                std::cout << "Binary cache is disabled, skip <BinaryCache>\n";
+                return;
+            }
 
-            for (auto& future : buildFutures)
-                future.wait();
+            auto const buildAll = [](const char* variant)
+            {
+                int count{};
+                Timer<false> t;
+                for (auto&& entry : std::filesystem::directory_iterator{ "./test" })
+                {
+                    if (auto const& path = entry.path(); path.extension() == ".cl")
+                    {
+                        auto kernel = compiler.build(path, { CompileOption::Optimize::FastMath }, { CompileOption::Std::CL2_0 });
+                        ++count;
+                    }
+                }
+                auto const rate = t.perSec(count);
+                std::cout << rate << " kernels /s\n";
+                reporter.report(rate, "kernels/s", variant);
+            };
 
-            std::cout << "Loaded " << count << " kernels from binary " << t.perSec(count) << " kernels /s\n";
+            binaryCache.setEnabled(true);
+            binaryCache.clear();
+            std::cout << "Testing <BinaryCacheCold> -> ";
+            buildAll("BinaryCacheCold");
+            std::cout << "Testing <BinaryCacheWarm> -> ";
+            buildAll("BinaryCacheWarm");
         }
+#endif
 
         void Compilation()
         {
-            SingleThread();
+#ifndef ANDROID
+            /*measure the real compilation, the cache is tested on its own*/
+            auto const cacheEnabled = binaryCache.isEnabled();
+            binaryCache.setEnabled(false);
+#endif
+            [[maybe_unused]] auto const singleThreadRate = SingleThread();
             MultiThreadWithAsync();
 
             MultiThreadWithThread();
             LoadFromBinary();
             MultiThreadLoadFromBinary();
+#ifndef ANDROID
+            BuildPipeline(singleThreadRate);
+            BinaryCache();
+            binaryCache.setEnabled(cacheEnabled);
+#endif
         }
 
     }
 
     namespace Timing
     {
-        static inline void PrintProfilingDiff(cl::Event const& timingEvent, std::chrono::steady_clock::duration scopedTimerTick)
+        static inline void PrintProfilingDiff(Profiler::Record const& record, std::chrono::steady_clock::duration scopedTimerTick)
         {
-            auto const clTime = timingEvent.getProfilingInfo<CL_PROFILING_COMMAND_END>() - timingEvent.getProfilingInfo<CL_PROFILING_COMMAND_START>();
-            std::cout << "OpenCL profile result: " << clTime / 1000 << " ns. Diff = " << ::abs(std::chrono::duration_cast<std::chrono::microseconds>(scopedTimerTick).count(), clTime / 1000) << '\n';
+            auto const clTime = record.executionTime();
+            std::cout << "OpenCL profile result: " << clTime / 1000 << " us (queued for " << (record.hostQueueTime() + record.deviceQueueTime()) / 1000 << " us)"
+                << ". Diff = " << ::abs(std::chrono::duration_cast<std::chrono::microseconds>(scopedTimerTick).count(), clTime / 1000) << '\n';
         }
 
         void ProfileKernelExecution()
         {
-            /*Create a new command_queue with profiling enabled*/
-            cl::CommandQueue queue{ gpu.getCLContext(), CL_QUEUE_PROFILING_ENABLE };
-            cl::Event timing;
+            gpu.setProfiling(true);
+            gpu.getProfiler().clear();
 
             /*allocate buffer*/
             const auto size = 300'000;
-            cl::Buffer resultBuffer{ gpu.getCLContext(), CL_MEM_WRITE_ONLY, size };
-
-            /*Get kernel ready*/
-            auto kernel = gpu["FindPrime"];
-            kernel.setArg(0, resultBuffer);
-            kernel.setArg(1, cl_ulong{ 3 });
+            auto resultBuffer = gpu.malloc<char, AccessMode::Write>(size);
 
             /*enqueue kernel*/
             std::chrono::steady_clock::duration duration{};
             {
                 Timer<true> const t;
-                queue.enqueueNDRangeKernel(kernel, { 0 }, { size }, cl::NullRange, {}, &timing);
-                queue.finish();
+                gpu.enqueueKernel(gpu["FindPrime"], std::make_tuple(resultBuffer.getClBuffer(), cl_ulong{ 3 }), { 0 }, { size });
+                gpu.finish();
                 duration = t.getDuration();
             }
             /*get profiling info*/
-            PrintProfilingDiff(timing, duration);
+            PrintProfilingDiff(gpu.getProfiler().getRecords().back(), duration);
+            gpu.setProfiling(false);
         }
 
         void ProfileDataTransfer()
         {
-            /*Create a new command_queue with profiling enabled*/
-            cl::CommandQueue queue{ gpu.getCLContext(), CL_QUEUE_PROFILING_ENABLE };
-            cl::Event timing;
+            gpu.setProfiling(true);
+            gpu.getProfiler().clear();
 
             /*allocate buffer*/
-            constexpr auto size = 1_gb;
-            cl::Buffer buffer{ gpu.getCLContext(), CL_MEM_READ_ONLY, size };
+            auto const size = std::min<size_t>(1_gb, GetCapacity(gpu.getDevice()).transferLimit());
+            auto buffer = gpu.malloc<char, AccessMode::Read>(size);
             auto const data = std::make_unique<char[]>(size);
 
             /*enqueue write buffer*/
             std::chrono::steady_clock::duration duration{};
             {
                 Timer<true> const t;
-                queue.enqueueWriteBuffer(buffer, true, 0, size, data.get(), {}, &timing);
-                queue.finish();
+                buffer.copyFrom(data.get(), size, true);
+                gpu.finish();
                 duration = t.getDuration();
             }
             /*get profiling info*/
-            PrintProfilingDiff(timing, duration);
+            PrintProfilingDiff(gpu.getProfiler().getRecords().back(), duration);
+            gpu.setProfiling(false);
+        }
+
+        void ProfileReduction()
+        {
+            gpu.setProfiling(true);
+            gpu.getProfiler().clear();
+            Benchmark::Reduction::InterleavedAddressingDivergent(1 << 24);
+            gpu.getProfiler().print(std::cout);
+            gpu.setProfiling(false);
         }
 
     }
@@ -751,17 +1513,18 @@ namespace test
     {
         void UseHostPtr()
         {
-            for(auto const size:{1_gb, 2_gb, 4_gb, 6_gb, 8_gb})
+            for (auto const size : SizeSweep(1_gb, GetCapacity(gpu.getDevice()).hostBudget()))
             {
                 std::cout << "Using CL_MEM_USE_HOST_PTR to allocate " << toMb(size) << " MB buffer ";
-                auto const ramUsageBefore = GetRamUsage();
+                auto const ramUsageBefore = GetProcessMemory().rss;
 
                 try {
-                    auto hostPtr = std::make_unique<char[]>(size);
-                    auto buffer = gpu.malloc<char, AccessMode::Read>(size, CL_MEM_USE_HOST_PTR, hostPtr.get());
-                    auto const ramUsageAfter = GetRamUsage();
+                    /*aligned for the device, otherwise the runtime silently copies it*/
+                    auto buffer = gpu.mallocZeroCopy<char, AccessMode::Read>(size);
+                    auto const ramUsageAfter = GetProcessMemory().rss;
 
-                    std::cout << "Ram usage = " << toMb(ramUsageAfter - ramUsageBefore) << " MB\n";
+                    std::cout << "Process RAM usage = " << (static_cast<double>(ramUsageAfter) - static_cast<double>(ramUsageBefore)) / 1_mb << " MB, "
+                        << (buffer.isZeroCopy() ? "mapped in place (zero-copy)" : "mapped to a copy") << '\n';
                 }
                 catch(cl::Error const& err)
                 {
@@ -774,15 +1537,15 @@ namespace test
 
         void AllocHostPtr()
         {
-            for (auto const size : {1_gb, 2_gb, 4_gb, 6_gb, 8_gb})
+            for (auto const size : SizeSweep(1_gb, GetCapacity(gpu.getDevice()).hostBudget()))
             {
                 std::cout << "Using CL_MEM_ALLOC_HOST_PTR to allocate " << toMb(size) << " MB buffer ";
-                auto const ramUsageBefore = GetRamUsage();
+                auto const ramUsageBefore = GetProcessMemory().rss;
                 try {
                     auto buffer = gpu.malloc<char, AccessMode::Read>(size, CL_MEM_ALLOC_HOST_PTR);
-                    auto const ramUsageAfter = GetRamUsage();
+                    auto const ramUsageAfter = GetProcessMemory().rss;
 
-                    std::cout << "Ram usage = " << toMb(ramUsageAfter - ramUsageBefore) << " MB\n";
+                    std::cout << "Process RAM usage = " << (static_cast<double>(ramUsageAfter) - static_cast<double>(ramUsageBefore)) / 1_mb << " MB\n";
                 }
                 catch(cl::Error const& err)
                 {
@@ -795,14 +1558,14 @@ namespace test
 
         void AllocHostPtrWithUseHostPtr()
         {
-            for (auto const size : {1_gb, 2_gb, 4_gb, 6_gb, 8_gb})
+            for (auto const size : SizeSweep(1_gb, GetCapacity(gpu.getDevice()).hostBudget()))
             {
                 std::cout << "Using CL_MEM_ALLOC_HOST_PTR | CL_MEM_USE_HOST_PTR to allocate " << toMb(size) << " buffer";
-                auto const ramUsageBefore = GetRamUsage();
+                auto const ramUsageBefore = GetProcessMemory().rss;
                 auto buffer = gpu.malloc<char, AccessMode::Read>(size, CL_MEM_ALLOC_HOST_PTR | CL_MEM_USE_HOST_PTR);
-                auto const ramUsageAfter = GetRamUsage();
+                auto const ramUsageAfter = GetProcessMemory().rss;
 
-                std::cout << "Ram usage = " << toMb(ramUsageAfter - ramUsageBefore) << " MB\n";
+                std::cout << "Process RAM usage = " << (static_cast<double>(ramUsageAfter) - static_cast<double>(ramUsageBefore)) / 1_mb << " MB\n";
             }
         }
 
@@ -835,11 +1598,12 @@ namespace test
                 auto buffer = makeData(numElements);
                 float result{};
 
+                auto const stats = measure([&]
                 {
-                    Timer<true> t;
                     result = std::accumulate(buffer.get(), buffer.get() + numElements, 0.0f);
-                    std::cout << toGb(t.perSec(numElements * sizeof(float))) << " GB/s. Reduce result = " << result << '\n';
-                }
+                });
+                reporter.report(stats, toGb(numElements * sizeof(float)), "GB/s");
+                std::cout << "Reduce result = " << result << '\n';
             }
 
             void StdReduce(size_t numElements)
@@ -848,47 +1612,63 @@ namespace test
                 auto buffer = makeData(numElements);
                 float result{};
 
+                auto const stats = measure([&]
                 {
-                    Timer<true> t;
                     result = std::reduce(buffer.get(), buffer.get() + numElements, 0.0f);
-                    std::cout << toGb(t.perSec(numElements * sizeof(float))) << " GB/s. Reduce result = " << result << '\n';
-                }
+                });
+                reporter.report(stats, toGb(numElements * sizeof(float)), "GB/s");
+                std::cout << "Reduce result = " << result << '\n';
             }
 
-            void InterleavedAddressingImpl(const char* kernelName, size_t numElements)
+            void InterleavedAddressingImpl(const char* kernelName, size_t const total)
             {
-                auto const total = numElements;
-                std::cout << "Testing <"<< kernelName <<"> with " << numElements << '\n';
-                auto data = makeData(numElements);
-                auto numWorkGroups = ceil(numElements, workGroupSize);
-
-
-                auto inBuffer = gpu.malloc<float, AccessMode::ReadWrite>(numElements, data.get());
-                auto outBuffer = gpu.malloc<float, AccessMode::ReadWrite>(numWorkGroups);
-
-                auto kernel = gpu[kernelName];
+                std::cout << "Testing <"<< kernelName <<"> with " << total << '\n';
+                auto data = makeData(total);
+
+
+                auto inBuffer = gpu.malloc<float, AccessMode::ReadWrite>(total, data.get());
+                auto outBuffer = gpu.malloc<float, AccessMode::ReadWrite>(ceil(total, workGroupSize));
+
+                /*the local memory argument is bound once, each round only swaps the 2 buffers and the range*/
+                KernelLaunch launch{
+                    gpu,
+                    gpu[kernelName],
+                    std::make_tuple(inBuffer.getClBuffer(), outBuffer.getClBuffer(), std::make_tuple(sizeof(float) * workGroupSize, nullptr)),
+                    { 0 },
+                    { total }
+                };
+
+                /*every sample reduces the same data, the upload is not timed*/
+                auto* in = &inBuffer;
+                int round{};
+                auto const stats = measure([&]
                 {
-                    int round{};
-                    Timer<true> t;
+                    inBuffer.copyFrom(data.get(), total, true);
+                    in = &inBuffer;
+                    auto* out = &outBuffer;
+                    auto numElements = total;
+                    auto numWorkGroups = ceil(numElements, workGroupSize);
+                    round = 0;
+
+                    Timer<false> const t;
                     while (numElements >= workGroupSize)
                     {
-                        gpu.enqueueKernel(
-                            kernel,
-                            std::make_tuple(inBuffer.getClBuffer(), outBuffer.getClBuffer(), std::make_tuple(sizeof(float) * workGroupSize, nullptr)),
-                            { 0 },
-                            { numElements },
-                            { ::std::min(workGroupSize, numElements) }
-                        );
-                        std::swap(inBuffer, outBuffer);
+                        launch.set<0>(in->getClBuffer())
+                            .set<1>(out->getClBuffer())
+                            .setRange({ numElements }, { ::std::min(workGroupSize, numElements) })
+                            .enqueue();
+                        std::swap(in, out);
                         numElements = numWorkGroups;
                         numWorkGroups = ceil(numElements, workGroupSize);
                         ++round;
                     }
                     gpu.finish();
-                    std::cout << toGb(t.perSec(total * sizeof(float))) << " GB/s Round = " << round << "\n";
-                }
+                    return t.getDuration();
+                });
+                std::cout << "Round = " << round << ", ";
+                reporter.report(stats, toGb(total * sizeof(float)), "GB/s");
 
-                auto mappedResult = inBuffer.map<AccessMode::Read>();
+                auto mappedResult = in->map<AccessMode::Read>();
                 std::cout << "Reduce result: " << *mappedResult.m_ptr << '\n';
             }
 
@@ -941,98 +1721,242 @@ namespace test
                 InterleavedAddressingImpl("ReduceSequential", numElements);
             }
 
-            void FirstAddDuringLoad(size_t numElements)
+            void FirstAddDuringLoad(size_t const total)
             {
-                auto const total = numElements;
-                std::cout << "Testing <FirstAddDuringLoad> with " << numElements << '\n';
-                auto data = makeData(numElements);
-                auto numWorkGroups = ceil(numElements, workGroupSize);
+                std::cout << "Testing <FirstAddDuringLoad> with " << total << '\n';
+                auto data = makeData(total);
 
 
-                auto inBuffer = gpu.malloc<float, AccessMode::ReadWrite>(numElements, data.get());
-                auto outBuffer = gpu.malloc<float, AccessMode::ReadWrite>(numWorkGroups);
+                auto inBuffer = gpu.malloc<float, AccessMode::ReadWrite>(total, data.get());
+                auto outBuffer = gpu.malloc<float, AccessMode::ReadWrite>(ceil(total, workGroupSize));
 
                 auto kernel = gpu["FirstAddDuringLoad"];
+                auto* in = &inBuffer;
+                int round{};
+                auto const stats = measure([&]
                 {
-                    int round{};
-                    Timer<true> t;
+                    inBuffer.copyFrom(data.get(), total, true);
+                    in = &inBuffer;
+                    auto* out = &outBuffer;
+                    auto numElements = total;
+                    auto numWorkGroups = ceil(numElements, workGroupSize);
+                    round = 0;
+
+                    /*every round depends on the previous one, and the whole chain is submitted at once*/
+                    Timer<false> const t;
+                    TaskGraph graph{ gpu };
                     while (numElements >= workGroupSize)
                     {
-                        gpu.enqueueKernel(
+                        auto const previous = graph.size();
+                        graph.kernel(
                             kernel,
-                            std::make_tuple(inBuffer.getClBuffer(), outBuffer.getClBuffer(), std::make_tuple(sizeof(float) * workGroupSize, nullptr)),
+                            std::make_tuple(in->getClBuffer(), out->getClBuffer(), std::make_tuple(sizeof(float) * workGroupSize, nullptr)),
                             { 0 },
                             { numElements/2 },
-                            { ::std::min(workGroupSize, numElements) }
+                            { ::std::min(workGroupSize, numElements) },
+                            round == 0 ? TaskGraph::Dependencies{} : TaskGraph::Dependencies{ previous - 1 }
                         );
-                        std::swap(inBuffer, outBuffer);
+                        std::swap(in, out);
                         numElements = numWorkGroups;
                         numWorkGroups = ceil(numElements, workGroupSize);
                         ++round;
                     }
-                    gpu.finish();
-                    std::cout << toGb(t.perSec(total * sizeof(float))) << " GB/s Round = " << round << "\n";
-                }
-
-                auto mappedResult = inBuffer.map<AccessMode::Read>();
+                    graph.submit();
+                    graph.wait();
+                    return t.getDuration();
+                });
+                std::cout << "Round = " << round << ", ";
+                reporter.report(stats, toGb(total * sizeof(float)), "GB/s");
+
+                auto mappedResult = in->map<AccessMode::Read>();
                 std::cout << "Reduce result: " << *mappedResult.m_ptr << '\n';
                 
             }
 
             void Reduction()
             {
-                try {
-                    for (size_t size=1ull<<18; size<=(1ull<<26); size<<=1)
-                    {
-                        InterleavedAddressingDivergent(size);
-                    }
-                }catch(...){}
-                try {
-                    for (size_t size = 1ull << 18; size <= (1ull << 26); size <<= 1)
-                    {
-                        InterleavedAddressingNonDivergent(size);
-                    }
+                Benchmarks().run(Registry::Selection::group("Reduction"));
+            }
+        }
+
+        namespace Allocation
+        {
+            /*the sizes of DataTransfer::CopyToDevice that fit in the default pool*/
+            static constexpr std::array allocationBytes{ 4_kb, 1_mb, 32_mb };
+
+            static size_t IterationsOf(size_t bytes)
+            {
+                return bytes <= 1_mb ? 10'000 : 200;
+            }
+
+            void PerCall(size_t bytes)
+            {
+                auto const iterations = IterationsOf(bytes);
+                std::cout << "Testing <AllocatePerCall> " << toMb(bytes) << " MB -> ";
+                char const data{};
+                gpu.finish();
+
+                Timer<false> t;
+                for (size_t i = 0; i < iterations; ++i)
+                {
+                    /*clCreateBuffer and clReleaseMemObject every time, a 1 byte write makes the driver really allocate it*/
+                    Buffer<char> buffer{ bytes, gpu.getCLContext(), gpu.getCLQueue(), AccessMode::ReadWrite };
+                    buffer.copyFrom(&data, 1, true);
                 }
-                catch (...) {}
-                try {
-                    for (size_t size = 1ull << 18; size <= (1ull << 26); size <<= 1)
-                    {
-                        SequentialAddressing(size);
-                    }
-                }catch(...){}
-                try {
-                    for (size_t size = 1ull << 18; size <= (1ull << 26); size <<= 1)
-                    {
-                        FirstAddDuringLoad(size);
-                    }
-                }catch(...){}
+                gpu.finish();
+                auto const rate = t.perSec(iterations);
+                std::cout << rate << " allocations /s\n";
+                reporter.report(rate, "allocations/s");
+            }
+
+            void Pooled(size_t bytes)
+            {
+                auto const iterations = IterationsOf(bytes);
+                std::cout << "Testing <AllocatePooled> " << toMb(bytes) << " MB -> ";
+                char const data{};
+                auto& pool = gpu.getBufferPool();
+                pool.resetStats();
+                gpu.finish();
+
+                Timer<false> t;
+                for (size_t i = 0; i < iterations; ++i)
+                {
+                    /*blocking, so no command still holds the buffer when it goes back to the pool*/
+                    auto buffer = gpu.malloc<char, AccessMode::ReadWrite>(bytes);
+                    buffer.copyFrom(&data, 1, true);
+                }
+                gpu.finish();
+                auto const rate = t.perSec(iterations);
+                auto const stats = pool.getStats();
+                std::cout << rate << " allocations /s, hits: " << stats.hits << ", misses: " << stats.misses << '\n';
+                reporter.report(rate, "allocations/s");
+            }
+
+            void Allocation()
+            {
+                Benchmarks().run(Registry::Selection::group("Allocation"));
+            }
+        }
+
+        namespace LaunchOverhead
+        {
+            /*a reduction-like launch: 2 buffers that are swapped every launch and a local memory argument*/
+            constexpr size_t elements = workGroupSize;
+
+            void EnqueueKernel(size_t launches)
+            {
+                std::cout << "Testing <enqueueKernel> with " << launches << " launches -> ";
+                auto inBuffer = gpu.malloc<float, AccessMode::ReadWrite>(elements);
+                auto outBuffer = gpu.malloc<float, AccessMode::ReadWrite>(elements);
+                auto kernel = gpu["ReduceInterleaved"];
+                gpu.finish();
+
+                Timer<false> t;
+                for (size_t i = 0; i < launches; ++i)
+                {
+                    gpu.enqueueKernel(
+                        kernel,
+                        std::make_tuple(inBuffer.getClBuffer(), outBuffer.getClBuffer(), std::make_tuple(sizeof(float) * workGroupSize, nullptr)),
+                        { 0 },
+                        { elements },
+                        { workGroupSize }
+                    );
+                    std::swap(inBuffer, outBuffer);
+                }
+                gpu.finish();
+                auto const rate = t.perSec(launches);
+                std::cout << rate << " launches /s\n";
+                reporter.report(rate, "launches/s");
+            }
+
+            void BoundLaunch(size_t launches)
+            {
+                std::cout << "Testing <KernelLaunch> with " << launches << " launches -> ";
+                auto inBuffer = gpu.malloc<float, AccessMode::ReadWrite>(elements);
+                auto outBuffer = gpu.malloc<float, AccessMode::ReadWrite>(elements);
+                KernelLaunch launch{
+                    gpu,
+                    gpu["ReduceInterleaved"],
+                    std::make_tuple(inBuffer.getClBuffer(), outBuffer.getClBuffer(), std::make_tuple(sizeof(float) * workGroupSize, nullptr)),
+                    { 0 },
+                    { elements },
+                    { workGroupSize }
+                };
+                gpu.finish();
+
+                Timer<false> t;
+                for (size_t i = 0; i < launches; ++i)
+                {
+                    launch.set<0>(inBuffer.getClBuffer()).set<1>(outBuffer.getClBuffer()).enqueue();
+                    std::swap(inBuffer, outBuffer);
+                }
+                launch.flush();
+                gpu.finish();
+                auto const rate = t.perSec(launches);
+                std::cout << rate << " launches /s\n";
+                reporter.report(rate, "launches/s");
+            }
+
+            void BoundLaunchUnchanged(size_t launches)
+            {
+                std::cout << "Testing <KernelLaunch without argument change> with " << launches << " launches -> ";
+                auto inBuffer = gpu.malloc<float, AccessMode::ReadWrite>(elements);
+                auto outBuffer = gpu.malloc<float, AccessMode::ReadWrite>(elements);
+                KernelLaunch launch{
+                    gpu,
+                    gpu["ReduceInterleaved"],
+                    std::make_tuple(inBuffer.getClBuffer(), outBuffer.getClBuffer(), std::make_tuple(sizeof(float) * workGroupSize, nullptr)),
+                    { 0 },
+                    { elements },
+                    { workGroupSize }
+                };
+                gpu.finish();
+
+                Timer<false> t;
+                launch.enqueue(launches);
+                launch.flush();
+                gpu.finish();
+                auto const rate = t.perSec(launches);
+                std::cout << rate << " launches /s\n";
+                reporter.report(rate, "launches/s");
+            }
+
+            void LaunchOverhead()
+            {
+                Benchmarks().run(Registry::Selection::group("LaunchOverhead"));
             }
         }
 
         namespace MatrixMultiplication
         {
+            /*the GFlops are computed from the median time of the samples*/
+            template<typename Func>
+            void MeasureMul(size_t size, Func&& func)
+            {
+                auto const stats = measure(std::forward<Func>(func));
+                reporter.report(stats, toGb(2 * pow(size, 3)), "GFlops");
+            }
+
             void NaiveCPU(size_t size)
             {
                 std::cout << "Testing <NaiveMulCPU> with " << size << " x " << size << '\n';
                 auto a = Matrix::make_random_matrix(size, size);
                 auto b = Matrix::make_random_matrix(size, size);
+                MeasureMul(size, [&]
                 {
-                    Timer<true> t;
                     NaiveCPUMul(a, b);
-                    std::cout << toGb(t.perSec(2 * pow(size, 3))) << " GFlops\n";
-                }
+                });
             }
             void TransposedCPU(size_t size)
             {
                 std::cout << "Testing <TransposedCPU> with " << size << " x " << size << '\n';
                 auto a = Matrix::make_random_matrix(size, size);
                 auto b = Matrix::make_random_matrix(size, size);
+                MeasureMul(size, [&]
                 {
-                    Timer<true> t;
                     auto b_T = b.transpose();
                     TransposedCPUMul(a, b_T);
-                    std::cout << toGb(t.perSec(2 * pow(size, 3))) << " GFlops\n";
-                }
+                });
             }
 
             /**
@@ -1053,17 +1977,15 @@ namespace test
                 auto result_buf = gpu.malloc<float, AccessMode::Write>(result.size());
 
 
-                gpu.enqueueKernel(gpu["NaiveMul"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), result_buf.getClBuffer()), {}, { size, size });
+                MeasureMul(size, [&]
                 {
-                    Timer<true> t;
-#ifdef DEBUG
-                    auto mappedResult = result_buf.map<AccessMode::Read>();
-                    result.data = mappedResult.m_ptr;
-#else
+                    gpu.enqueueKernel(gpu["NaiveMul"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), result_buf.getClBuffer()), {}, { size, size });
                     gpu.finish();
-                    std::cout << toGb(t.perSec(2 * pow(size, 3))) << " GFlops\n";
+                });
+#ifdef DEBUG
+                auto mappedResult = result_buf.map<AccessMode::Read>();
+                result.data = mappedResult.m_ptr;
 #endif
-                }
             }
 
             /**
@@ -1083,17 +2005,15 @@ namespace test
                 auto b_buf = gpu.malloc<float, AccessMode::Read>(b.size(), b.data);
                 auto result_buf = gpu.malloc<float, AccessMode::Write>(result.size());
 
-                gpu.enqueueKernel(gpu["TransposedMul"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), result_buf.getClBuffer()), {}, { size, size });
+                MeasureMul(size, [&]
                 {
-                    Timer<true> t;
-#ifdef DEBUG
-                    auto mappedResult = result_buf.map<AccessMode::Read>();
-                    result.data = mappedResult.m_ptr;
-#else
+                    gpu.enqueueKernel(gpu["TransposedMul"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), result_buf.getClBuffer()), {}, { size, size });
                     gpu.finish();
-                    std::cout << toGb(t.perSec(2 * pow(size, 3))) << " GFlops\n";
+                });
+#ifdef DEBUG
+                auto mappedResult = result_buf.map<AccessMode::Read>();
+                result.data = mappedResult.m_ptr;
 #endif
-                }
             }
 
             /**
@@ -1109,23 +2029,23 @@ namespace test
                 auto b_buf = gpu.malloc<float, AccessMode::Read>(b.size(), b.data);
                 auto b_T_buf = gpu.malloc<float, AccessMode::ReadWrite>(b.size());
 
+                auto result_buf = gpu.malloc<float, AccessMode::Write>(b.size());
+
                 Matrix result{ size, size, Matrix::NoAlloc{} };
-                auto transposeKernel = gpu["Transpose"];
-                auto transposeMulKernel = gpu["TransposedMul"];
+
+                /*transpose -> multiply is submitted as one graph, so there is no host round-trip between the stages*/
+                TaskGraph graph{ gpu };
+                auto const transpose = graph.kernel(gpu["Transpose"], std::make_tuple(b_buf.getClBuffer(), b_T_buf.getClBuffer()), {}, { size, size });
+                graph.kernel(gpu["TransposedMul"], std::make_tuple(a_buf.getClBuffer(), b_T_buf.getClBuffer(), result_buf.getClBuffer()), {}, { size, size }, cl::NullRange, { transpose });
+                MeasureMul(size, [&]
                 {
-                    Timer<true> t;
-                    gpu.enqueueKernel(std::move(transposeKernel), std::make_tuple(b_buf.getClBuffer(), b_T_buf.getClBuffer()), {}, { size, size });
-                    auto result_buf = gpu.malloc<float, AccessMode::Write>(result.size());
-                    gpu.enqueueKernel(std::move(transposeMulKernel), std::make_tuple(a_buf.getClBuffer(), b_T_buf.getClBuffer(), result_buf.getClBuffer()), {}, { size, size });
+                    graph.submit();
+                    graph.wait();
+                });
 #ifdef DEBUG
-                    auto mappedResult = result_buf.map<AccessMode::Read>();
-                    result.data = mappedResult.m_ptr;
-#else
-                    gpu.finish();
-                    std::cout << toGb(t.perSec(2 * pow(size, 3))) << " GFlops\n";
+                auto mappedResult = result_buf.map<AccessMode::Read>();
+                result.data = mappedResult.m_ptr;
 #endif
-
-                }
             }
 
             
@@ -1147,19 +2067,15 @@ namespace test
 
                 auto const localMemSize = block_dim*block_dim * sizeof(float);
                
-                gpu.enqueueKernel(gpu["BlockMul"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), std::make_tuple(localMemSize, nullptr), std::make_tuple(localMemSize, nullptr), result_buf.getClBuffer()), {}, { size, size }, { block_dim, block_dim });
+                MeasureMul(size, [&]
                 {
-                    Timer<true> t;
-
-#ifdef DEBUG
-                    auto mappedResult = result_buf.map<AccessMode::Read>();
-                    result.data = mappedResult.m_ptr;
-
-#else
+                    gpu.enqueueKernel(gpu["BlockMul"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), std::make_tuple(localMemSize, nullptr), std::make_tuple(localMemSize, nullptr), result_buf.getClBuffer()), {}, { size, size }, { block_dim, block_dim });
                     gpu.finish();
-                    std::cout << toGb(t.perSec(2 * pow(size, 3))) << " GFlops\n";
+                });
+#ifdef DEBUG
+                auto mappedResult = result_buf.map<AccessMode::Read>();
+                result.data = mappedResult.m_ptr;
 #endif
-                }
             }
 
             void UseNonConstantMemory(size_t size)
@@ -1177,19 +2093,15 @@ namespace test
 
                 auto const localMemSize = block_dim * block_dim * sizeof(float);
 
-                gpu.enqueueKernel(gpu["BlockMulNonConstant"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), std::make_tuple(localMemSize, nullptr), std::make_tuple(localMemSize, nullptr), result_buf.getClBuffer()), {}, { size, size }, { block_dim, block_dim });
+                MeasureMul(size, [&]
                 {
-                    Timer<true> t;
-
-#ifdef DEBUG
-                    auto mappedResult = result_buf.map<AccessMode::Read>();
-                    result.data = mappedResult.m_ptr;
-
-#else
+                    gpu.enqueueKernel(gpu["BlockMulNonConstant"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), std::make_tuple(localMemSize, nullptr), std::make_tuple(localMemSize, nullptr), result_buf.getClBuffer()), {}, { size, size }, { block_dim, block_dim });
                     gpu.finish();
-                    std::cout << toGb(t.perSec(2 * pow(size, 3))) << " GFlops\n";
+                });
+#ifdef DEBUG
+                auto mappedResult = result_buf.map<AccessMode::Read>();
+                result.data = mappedResult.m_ptr;
 #endif
-                }
             }
 
             void UnrolledMul(size_t size)
@@ -1207,19 +2119,15 @@ namespace test
 
                 auto const localMemSize = block_dim * block_dim * sizeof(float);
 
-                gpu.enqueueKernel(gpu["UnrolledMul"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), std::make_tuple(localMemSize, nullptr), std::make_tuple(localMemSize, nullptr), result_buf.getClBuffer()), {}, { size, size }, { block_dim, block_dim });
+                MeasureMul(size, [&]
                 {
-                    Timer<true> t;
-
-#ifdef DEBUG
-                    auto mappedResult = result_buf.map<AccessMode::Read>();
-                    result.data = mappedResult.m_ptr;
-
-#else
+                    gpu.enqueueKernel(gpu["UnrolledMul"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), std::make_tuple(localMemSize, nullptr), std::make_tuple(localMemSize, nullptr), result_buf.getClBuffer()), {}, { size, size }, { block_dim, block_dim });
                     gpu.finish();
-                    std::cout << toGb(t.perSec(2 * pow(size, 3))) << " GFlops\n";
+                });
+#ifdef DEBUG
+                auto mappedResult = result_buf.map<AccessMode::Read>();
+                result.data = mappedResult.m_ptr;
 #endif
-                }
             }
 
 
@@ -1239,18 +2147,15 @@ namespace test
 
                 Matrix result{ size, size, Matrix::NoAlloc{} };
                 auto const localMemSize = block_dim * block_dim * sizeof(float);
-                gpu.enqueueKernel(gpu["RowBlockRowMajorMul"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), std::make_tuple(localMemSize, nullptr), std::make_tuple(localMemSize, nullptr), result_buf.getClBuffer()), {}, { size, size }, { block_dim, block_dim });
+                MeasureMul(size, [&]
                 {
-                    Timer<true> t;
-#ifdef DEBUG
-                    auto mappedResult = result_buf.map<AccessMode::Read>();
-                    result.data = mappedResult.m_ptr;
-
-#else
+                    gpu.enqueueKernel(gpu["RowBlockRowMajorMul"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), std::make_tuple(localMemSize, nullptr), std::make_tuple(localMemSize, nullptr), result_buf.getClBuffer()), {}, { size, size }, { block_dim, block_dim });
                     gpu.finish();
-                    std::cout << toGb(t.perSec(2 * pow(size, 3))) << " GFlops\n";
+                });
+#ifdef DEBUG
+                auto mappedResult = result_buf.map<AccessMode::Read>();
+                result.data = mappedResult.m_ptr;
 #endif
-                }
             }
 
 
@@ -1270,18 +2175,15 @@ namespace test
                     auto result_buf = gpu.malloc<float, AccessMode::Write>(b.size());
 
                     Matrix result{ size, size, Matrix::NoAlloc{} };
-                    gpu.enqueueKernel(gpu["MoreWorkMul"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), result_buf.getClBuffer()), {}, { size, size }, { block_dim, block_dim });
+                    MeasureMul(size, [&]
                     {
-                        Timer<true> t;
-#ifdef DEBUG
-                        auto mappedResult = result_buf.map<AccessMode::Read>();
-                        result.data = mappedResult.m_ptr;
-
-#else
+                        gpu.enqueueKernel(gpu["MoreWorkMul"], std::make_tuple(a_buf.getClBuffer(), b_buf.getClBuffer(), result_buf.getClBuffer()), {}, { size, size }, { block_dim, block_dim });
                         gpu.finish();
-                        std::cout << toGb(t.perSec(2 * pow(size, 3))) << " GFlops\n";
+                    });
+#ifdef DEBUG
+                    auto mappedResult = result_buf.map<AccessMode::Read>();
+                    result.data = mappedResult.m_ptr;
 #endif
-                    }
                 }
                 catch (cl::Error const& err)
                 {
@@ -1294,52 +2196,15 @@ namespace test
              */
             void MatrixMultiplication()
             {
-                auto const sizes = { 128, 256, 512, 1024, 2048};
-                for (const auto size :sizes)
-                {
-                    Naive(size);
-                }
-                for (const auto size : sizes)
-                {
-                    TransposeByCPU(size);
-                    gpu.finish();
-                }
-                //for (const auto size : sizes)
-                //{
-                //    TransposeByGPU(size);
-                //}
-                for (const auto size : sizes)
-                {
-                    UseLocalMemory(size);
-                }
-                for(const auto size:sizes)
-                {
-                    UnrolledMul(size);
-                }
-                for (const auto size : sizes)
-                {
-                    UseNonConstantMemory(size);
-                }
-                for(const auto size:sizes)
-                {
-                    RowBlockRowMajorOrdering(size);
-                }
-                for(const auto size:sizes)
-                {
-                    MoreWork(size);
-                }
+                Benchmarks().run(Registry::Selection::group("MatrixMultiplication"));
             }
             void MatrixMultiplicationCPU()
             {
-                auto const sizes = { 128, 256, 512, 1024, 2048 };
-                for(auto size:sizes)
-                {
-                    //NaiveCPU(size);
-                }
-                for(auto size:sizes)
-                {
-                    TransposedCPU(size);
-                }
+                /*NaiveCPU is optional, it takes minutes for the larger sizes*/
+                Registry::Selection selection;
+                selection.filter = std::regex{ "^MatrixMultiplicationCPU/TransposedCPU$" };
+                selection.includeOptional = true;
+                Benchmarks().run(selection);
             }
         }
 
@@ -1358,24 +2223,24 @@ namespace test
 
                 auto const halfFilterSizeStr = std::to_string(filter.halfSize());
                 auto const channelsStr = std::to_string(filter.channel());
-                auto kernels = compiler.build("NaiveConv", 
+                auto& kernel = gpu.kernel("NaiveConv",
                     { 
                         CompileOption::Optimize::FastMath,
                         CompileOption::Macro{"HALF_FILTER_SIZE", halfFilterSizeStr.c_str()},
                         CompileOption::Macro{"CHANNELS", channelsStr.c_str()}
                     }, { CompileOption::Std::CL2_0 });
 
+                auto const stats = measure([&]
                 {
-                    Timer<false> t;
                     gpu.enqueueKernel(
-                        kernels[0],
+                        kernel,
                         std::forward_as_tuple(inputBuf.getClBuffer(), outputBuf.getClBuffer(), filter.data),
                         {},
                         { pixel, pixel }
                     );
                     gpu.finish();
-                    std::cout << toGb(t.perSec(filter.area() * inputImage.size() * channels)) << " GFlops\n";
-                }
+                });
+                reporter.report(stats, toGb(filter.area() * inputImage.size() * channels), "GFlops", "filter=" + std::to_string(filterSize));
             }
 
             template<int filterSize, int channels>
@@ -1384,11 +2249,11 @@ namespace test
                 std::cout << "Testing <NaiveConvCPU> with " << pixel << " x " << pixel << "channel = " << channels << " with filter = " << filterSize << '\n';
                 auto filter = Filter<filterSize, channels>::makeFilter();
                 Image<channels> inputImage{ pixel + filter.halfSize() * 2, pixel + filter.halfSize() * 2 };
+                auto const stats = measure([&]
                 {
-                    Timer<true> t;
                     NaiveCPU(inputImage, filter);
-                    std::cout << toGb(t.perSec(filter.area() * inputImage.size() * channels)) << " GFlops\n";
-                }
+                });
+                reporter.report(stats, toGb(filter.area() * inputImage.size() * channels), "GFlops", "cpu filter=" + std::to_string(filterSize));
             }
 
             void Naive(size_t pixel)
@@ -1404,7 +2269,7 @@ namespace test
             }
 
             template<int filterSize, int channels>
-            void LoopUnrollImpl(size_t pixel, std::vector<cl::Kernel> const& kernels)
+            void LoopUnrollImpl(size_t pixel)
             {
                 std::cout << "Testing <UnrolledConv> with " << pixel << " x " << pixel << "channel = " << channels << " with filter = " << filterSize << '\n';
                 auto filter = Filter<filterSize, 1>::makeFilter();
@@ -1418,25 +2283,25 @@ namespace test
                 auto const channelsStr = std::to_string(filter.channel());
 
 
-                gpu.enqueueKernel(kernels[(filterSize - 3) / 2], std::forward_as_tuple(inputBuf.getClBuffer(), outputBuf.getClBuffer(), filter.data), {}, { pixel, pixel });
+                auto const kernelName = "UnrolledConv" + std::to_string(filterSize);
+                auto& kernel = gpu.kernel("UnrolledConv",
+                    {
+                        CompileOption::Optimize::FastMath,
+                        CompileOption::Macro{"CHANNELS", "1"}
+                    }, { CompileOption::Std::CL2_0 }, kernelName.c_str());
 
+                auto const stats = measure([&]
                 {
-                    Timer<false> t;
+                    gpu.enqueueKernel(kernel, std::forward_as_tuple(inputBuf.getClBuffer(), outputBuf.getClBuffer(), filter.data), {}, { pixel, pixel });
                     gpu.finish();
-                    std::cout << toGb(t.perSec(filter.area() * inputImage.size() * channels)) << " GFlops\n";
-                }
+                });
+                reporter.report(stats, toGb(filter.area() * inputImage.size() * channels), "GFlops", "filter=" + std::to_string(filterSize));
             }
 
             void LoopUnroll(size_t pixel)
             {
-                auto kernels = compiler.build("UnrolledConv",
-                    {
-                        CompileOption::Optimize::FastMath,
-                        CompileOption::Macro{"CHANNELS", "1"}
-                    }, { CompileOption::Std::CL2_0 });
-
-                LoopUnrollImpl<3, 1>(pixel, kernels);
-                LoopUnrollImpl<5, 1>(pixel, kernels);
+                LoopUnrollImpl<3, 1>(pixel);
+                LoopUnrollImpl<5, 1>(pixel);
             }
 
             template<int filterSize, int channels>
@@ -1452,7 +2317,7 @@ namespace test
 
                 auto const halfFilterSizeStr = std::to_string(filter.halfSize());
                 auto const channelsStr = std::to_string(filter.channel());
-                auto kernels = compiler.build("GroupedConv",
+                auto& kernel = gpu.kernel("GroupedConv",
                     {
                         CompileOption::Optimize::FastMath,
                         CompileOption::Macro{"HALF_FILTER_SIZE", halfFilterSizeStr.c_str()},
@@ -1461,18 +2326,18 @@ namespace test
 
                 const auto localDim = static_cast<size_t>(sqrt(workGroupSize));
 
+                auto const stats = measure([&]
                 {
-                    Timer<false> t;
                     gpu.enqueueKernel(
-                        kernels[0],
+                        kernel,
                         std::forward_as_tuple(inputBuf.getClBuffer(), outputBuf.getClBuffer(), filter.data, std::make_tuple(channels*localDim*localDim*sizeof(float), nullptr)),
                         {},
                         { pixel, pixel },
                         { localDim, localDim }
                     );
                     gpu.finish();
-                    std::cout << toGb(t.perSec(filter.area() * inputImage.size() * channels)) << " GFlops\n";
-                }
+                });
+                reporter.report(stats, toGb(filter.area() * inputImage.size() * channels), "GFlops", "filter=" + std::to_string(filterSize));
             }
 
             void GroupedConv(size_t pixel)
@@ -1485,12 +2350,272 @@ namespace test
 
             void Convolution()
             {
-                Naive(4096);
-                //LoopUnroll(8192);
-                GroupedConv(4096);
+                Benchmarks().run(Registry::Selection::group("Convolution"));
             }
         }
-    }
-}
 
+        namespace Pipeline
+        {
+            constexpr size_t totalBytes = 256_mb;
+            constexpr size_t slots = 3;     //device buffers in flight, chunk i reuses the buffer of chunk i - slots
+
+            /*pinned host memory, so the transfers can run asynchronously with the kernels*/
+            struct PinnedHost
+            {
+                cl::Buffer buffer;
+                double* ptr;
+
+                explicit PinnedHost(size_t bytes)
+                    : buffer{ gpu.getCLContext(), CL_MEM_ALLOC_HOST_PTR, bytes },
+                    ptr{ static_cast<double*>(gpu.getCLQueue().enqueueMapBuffer(buffer, true, CL_MAP_READ | CL_MAP_WRITE, 0, bytes)) }
+                {
+                }
+                ~PinnedHost()
+                {
+                    gpu.getCLQueue().enqueueUnmapMemObject(buffer, ptr);
+                    gpu.getCLQueue().finish();
+                }
+            };
+
+            void UploadComputeDownload(size_t chunkBytes)
+            {
+                std::cout << "Testing <upload -> SelfMul -> download> " << toMb(totalBytes) << " MB in " << toMb(chunkBytes) << " MB chunks\n";
+                if (gpu.getDevice().getInfo<CL_DEVICE_EXTENSIONS>().find("cl_khr_fp64") == std::string::npos)
+                {
+                    std::cout << "The device does not support double, skip <Pipeline>\n";
+                    return;
+                }
+                /*the stream count of the device is given back when this returns, after the buffers using the streams are gone*/
+                struct StreamCountGuard
+                {
+                    size_t previous = gpu.getStreamCount();
+                    ~StreamCountGuard() { gpu.setStreamCount(previous); }
+                } const streamCount;
+                if (streamCount.previous < 3)
+                    gpu.setStreamCount(3);
+
+                auto const chunkCount = totalBytes / chunkBytes;
+                auto const chunkElements = chunkBytes / sizeof(double);
+                PinnedHost input{ totalBytes };
+                PinnedHost output{ totalBytes };
+                std::iota(input.ptr, input.ptr + totalBytes / sizeof(double), 0.0);
+
+                std::vector<Buffer<double>> buffers;
+                for (size_t slot = 0; slot < slots; ++slot)
+                    buffers.push_back(gpu.malloc<double, AccessMode::ReadWrite>(chunkElements));
+                auto& kernel = gpu["SelfMul"];
+
+                /*serial: every stage waits for the previous one on a single queue, the stage times are the ideal pipeline*/
+                using FpSeconds = std::chrono::duration<double>;
+                std::vector<double> uploadTimes, computeTimes, downloadTimes;   //of every sample, in seconds
+                auto& queue = gpu.stream(0);
+                auto const serial = measure([&]
+                {
+                    std::chrono::steady_clock::duration uploadTime{}, computeTime{}, downloadTime{};
+                    for (size_t chunk = 0; chunk < chunkCount; ++chunk)
+                    {
+                        auto& buffer = buffers[chunk % slots];
+                        auto const offset = chunk * chunkElements;
+                        {
+                            Timer<false> const t;
+                            buffer.on(queue).copyFrom(input.ptr + offset, chunkElements, true);
+                            uploadTime += t.getDuration();
+                        }
+                        {
+                            Timer<false> const t;
+                            gpu.enqueueKernel(queue, kernel, std::make_tuple(buffer.getClBuffer(), 2.0), {}, { chunkElements }, cl::NullRange, nullptr, nullptr);
+                            queue.finish();
+                            computeTime += t.getDuration();
+                        }
+                        {
+                            Timer<false> const t;
+                            buffer.on(queue).copyTo(output.ptr + offset, chunkElements, true);
+                            downloadTime += t.getDuration();
+                        }
+                    }
+                    uploadTimes.push_back(FpSeconds{ uploadTime }.count());
+                    computeTimes.push_back(FpSeconds{ computeTime }.count());
+                    downloadTimes.push_back(FpSeconds{ downloadTime }.count());
+                });
+                /*the warmup samples are not in [serial], so they are not in the stage times either*/
+                auto const stageMedian = [&](std::vector<double> times)
+                {
+                    times.erase(times.begin(), times.begin() + static_cast<std::ptrdiff_t>(serial.warmup));
+                    return Statistics::compute(std::move(times)).median;
+                };
+                std::vector<double> transferTimes(uploadTimes.size());
+                std::transform(uploadTimes.cbegin(), uploadTimes.cend(), downloadTimes.cbegin(), transferTimes.begin(), std::plus<>{});
+                auto const uploadTime = stageMedian(uploadTimes);
+                auto const computeTime = stageMedian(computeTimes);
+                auto const downloadTime = stageMedian(downloadTimes);
+                auto const transferTime = stageMedian(std::move(transferTimes));
+                std::cout << "serial: ";
+                reporter.report(serial, toMb(totalBytes), "MB/s", "serial");
+
+                /*pipelined: chunk i + 1 is uploaded while chunk i is computed and chunk i - 1 is downloaded*/
+                for (size_t queueCount : { 2, 3 })
+                {
+                    auto& uploadQueue = gpu.stream(1);
+                    auto& computeQueue = gpu.stream(0);
+                    auto& downloadQueue = queueCount == 3 ? gpu.stream(2) : uploadQueue;
+
+                    auto const pipelined = measure([&]
+                    {
+                        std::vector<cl::Event> uploaded(chunkCount), computed(chunkCount), downloaded(chunkCount);
+                        for (size_t step = 0; step < chunkCount + 2; ++step)
+                        {
+                            if (step < chunkCount)
+                            {
+                                auto const chunk = step;
+                                std::vector<cl::Event> const reused{ chunk >= slots ? downloaded[chunk - slots] : cl::Event{} };
+                                buffers[chunk % slots].on(uploadQueue).copyFrom(input.ptr + chunk * chunkElements, chunkElements, false, chunk >= slots ? &reused : nullptr, &uploaded[chunk]);
+                                uploadQueue.flush();
+                            }
+                            if (step >= 1 && step - 1 < chunkCount)
+                            {
+                                auto const chunk = step - 1;
+                                std::vector<cl::Event> const waitFor{ uploaded[chunk] };
+                                gpu.enqueueKernel(computeQueue, kernel, std::make_tuple(buffers[chunk % slots].getClBuffer(), 2.0), {}, { chunkElements }, cl::NullRange, &waitFor, &computed[chunk]);
+                            }
+                            if (step >= 2)
+                            {
+                                auto const chunk = step - 2;
+                                std::vector<cl::Event> const waitFor{ computed[chunk] };
+                                buffers[chunk % slots].on(downloadQueue).copyTo(output.ptr + chunk * chunkElements, chunkElements, false, &waitFor, &downloaded[chunk]);
+                                downloadQueue.flush();
+                            }
+                        }
+                        cl::Event::waitForEvents(downloaded);
+                    });
 
+                    /*how much of the time that could be hidden by overlapping really was hidden, from the median stage times like serial.median*/
+                    auto const ideal = queueCount == 3
+                        ? std::max({ uploadTime, computeTime, downloadTime })
+                        : std::max(transferTime, computeTime);
+                    auto const hideable = serial.median - ideal;
+                    auto const efficiency = hideable > 0 ? (serial.median - pipelined.median) / hideable : 0.0;
+
+                    auto const variant = std::to_string(queueCount) + " queues";
+                    std::cout << variant << ": ";
+                    reporter.report(pipelined, toMb(totalBytes), "MB/s", variant);
+                    std::cout << variant << ": " << serial.median / pipelined.median << "x of serial, overlap efficiency " << efficiency * 100 << "%\n";
+                    reporter.report(efficiency * 100, "% overlap", variant);
+                }
+
+                auto const correct = output.ptr[0] == 0.0 && output.ptr[totalBytes / sizeof(double) - 1] == 2.0 * (totalBytes / sizeof(double) - 1);
+                if (!correct)
+                    std::cout << "Pipeline result is wrong\n";
+            }
+
+            void Pipeline()
+            {
+                Benchmarks().run(Registry::Selection::group("Pipeline"));
+            }
+        }
+    }
+    Registry const& Benchmarks()
+    {
+        static Registry const registry = []
+        {
+            using namespace Benchmark;
+            Registry registry;
+            /*the transfer sizes follow the device and the host memory, generated when each benchmark is run*/
+            auto const transferBytes = [](size_t first, size_t hostCopies) -> Registry::Sizes
+            {
+                return [=] { return SizeSweep(first, GetCapacity(gpu.getDevice()).transferLimit(hostCopies)); };
+            };
+            auto const testBytes = transferBytes(4_kb, 1);
+            auto const mapBytes = transferBytes(4_kb, 2);       //the runtime may stage the mapping in host memory
+            auto const readBytes = transferBytes(4_kb, 1);
+            auto const readMapBytes = transferBytes(4_kb, 2);
+            Registry::Sizes const largeBytes = []     //up to beyond the largest single allocation, where WriteBuffer fails
+            {
+                return SizeSweep(1_gb, GetCapacity(gpu.getDevice()).totalLimit(1));
+            };
+            std::vector<size_t> reductionElements;
+            for (size_t size = 1ull << 18; size <= (1ull << 26); size <<= 1)
+                reductionElements.push_back(size);
+            std::vector<size_t> const matrixSizes{ 128, 256, 512, 1024, 2048 };
+            std::vector<size_t> const launches{ 1'000, 10'000, 100'000 };
+            std::vector<size_t> const tiles{ 64, 256, 1024, 4096 };
+            std::vector<size_t> const zeroCopyBytes{ 4_kb, 1_mb, 32_mb, 512_mb };
+            std::vector<size_t> const onDeviceBytes{ 1_mb, 32_mb, 256_mb };
+            std::vector<size_t> const latencyBytes{ 4, 64, 1_kb, 4_kb, 64_kb, 256_kb };
+            std::vector<size_t> const hugePageBytes{ 32_mb, 512_mb };
+            std::vector<size_t> hostThreads;
+            for (size_t count = 1; count < ThreadPool::defaultThreadCount(); count *= 2)
+                hostThreads.push_back(count);
+            hostThreads.push_back(ThreadPool::defaultThreadCount());
+            std::vector<size_t> const allocationBytes{ Allocation::allocationBytes.cbegin(), Allocation::allocationBytes.cend() };
+
+            registry
+                .add("Capacity", "Probe", Capacity::Probe, true)
+                .add("HostBandwidth", "Stream", "threads", hostThreads, HostBandwidth::Stream)
+                .add("CopyToDevice", "CopyHostPtr", "bytes", testBytes, DataTransfer::CopyHostPtr)
+                .add("CopyToDevice", "WriteBuffer", "bytes", testBytes, DataTransfer::WriteBuffer)
+                .add("CopyToDevice", "WriteMapBuffer", "bytes", mapBytes, DataTransfer::WriteMapBuffer)
+                .add("CopyToDevice", "WriteStagingRing", "bytes", transferBytes(1_mb, 1), DataTransfer::WriteStagingRing)
+                .add("CopyToDevice", "WriteLargeBuffer", "bytes", largeBytes, DataTransfer::WriteLargeBuffer)
+                .add("CopyToDevice", "WriteBufferTotal", "bytes", testBytes, DataTransfer::WriteBufferTotal)
+                .add("CopyToDevice", "WriteMapBufferTotal", "bytes", mapBytes, DataTransfer::WriteMapBufferTotal)
+                .add("CopyToHost", "ReadBuffer", "bytes", readBytes, DataTransfer::ReadBuffer)
+                .add("CopyToHost", "ReadMapBuffer", "bytes", readMapBytes, DataTransfer::ReadMapBuffer)
+                .add("CopyToHost", "ReadMapBufferAsync", "bytes", readMapBytes, DataTransfer::ReadMapBufferAsync)
+                .add("RectTransfer", "WriteTileRect", "tile", tiles, DataTransfer::WriteTileRect)
+                .add("RectTransfer", "WriteTilePacked", "tile", tiles, DataTransfer::WriteTilePacked)
+                .add("RectTransfer", "ReadTileRect", "tile", tiles, DataTransfer::ReadTileRect)
+                .add("RectTransfer", "ReadTilePacked", "tile", tiles, DataTransfer::ReadTilePacked)
+                .add("ZeroCopy", "Write", "bytes", zeroCopyBytes, DataTransfer::ZeroCopyWrite)
+                .add("ZeroCopy", "Read", "bytes", zeroCopyBytes, DataTransfer::ZeroCopyRead)
+                .add("OnDevice", "Copy", "bytes", onDeviceBytes, DataTransfer::DeviceCopy)
+                .add("OnDevice", "Fill", "bytes", onDeviceBytes, DataTransfer::Fill)
+                .add("HugePages", "CopyHostPtr", "bytes", hugePageBytes, HugePages::CopyHostPtr, true)
+                .add("HugePages", "WriteBuffer", "bytes", hugePageBytes, HugePages::WriteBuffer, true)
+                .add("HugePages", "WriteMapBuffer", "bytes", hugePageBytes, HugePages::WriteMapBuffer, true)
+                .add("HugePages", "ReadBuffer", "bytes", hugePageBytes, HugePages::ReadBuffer, true)
+                .add("HugePages", "ReadMapBuffer", "bytes", hugePageBytes, HugePages::ReadMapBuffer, true)
+                .add("Numa", "Transfer", "bytes", { 32_mb, 256_mb }, Numa::Transfer, true)
+                .add("Latency", "CopyHostPtr", "bytes", latencyBytes, Latency::CopyHostPtr)
+                .add("Latency", "WriteBuffer", "bytes", latencyBytes, Latency::WriteBuffer)
+                .add("Latency", "MapUnmap", "bytes", latencyBytes, Latency::MapUnmap)
+                .add("Latency", "ReadBuffer", "bytes", latencyBytes, Latency::ReadBuffer)
+                .add("Compilation", "All", Compilation::Compilation)
+                .add("Reduction", "StdAccumulate", "elements", reductionElements, Reduction::StdAccumulate, true)
+                .add("Reduction", "StdReduce", "elements", reductionElements, Reduction::StdReduce, true)
+                .add("Reduction", "InterleavedAddressingDivergent", "elements", reductionElements, Reduction::InterleavedAddressingDivergent)
+                .add("Reduction", "InterleavedAddressingNonDivergent", "elements", reductionElements, Reduction::InterleavedAddressingNonDivergent)
+                .add("Reduction", "SequentialAddressing", "elements", reductionElements, Reduction::SequentialAddressing)
+                .add("Reduction", "FirstAddDuringLoad", "elements", reductionElements, Reduction::FirstAddDuringLoad)
+                .add("Timing", "ProfileKernelExecution", Timing::ProfileKernelExecution, true)
+                .add("Timing", "ProfileDataTransfer", Timing::ProfileDataTransfer, true)
+                .add("Timing", "ProfileReduction", Timing::ProfileReduction)
+                .add("LaunchOverhead", "EnqueueKernel", "launches", launches, LaunchOverhead::EnqueueKernel)
+                .add("LaunchOverhead", "BoundLaunch", "launches", launches, LaunchOverhead::BoundLaunch)
+                .add("LaunchOverhead", "BoundLaunchUnchanged", "launches", launches, LaunchOverhead::BoundLaunchUnchanged)
+                .add("Allocation", "PerCall", "bytes", allocationBytes, Allocation::PerCall)
+                .add("Allocation", "Pooled", "bytes", allocationBytes, Allocation::Pooled)
+                .add("MatrixMultiplication", "Naive", "size", matrixSizes, MatrixMultiplication::Naive)
+                .add("MatrixMultiplication", "TransposeByCPU", "size", matrixSizes, MatrixMultiplication::TransposeByCPU)
+                .add("MatrixMultiplication", "TransposeByGPU", "size", matrixSizes, MatrixMultiplication::TransposeByGPU)
+                .add("MatrixMultiplication", "UseLocalMemory", "size", matrixSizes, MatrixMultiplication::UseLocalMemory)
+                .add("MatrixMultiplication", "UnrolledMul", "size", matrixSizes, MatrixMultiplication::UnrolledMul)
+                .add("MatrixMultiplication", "UseNonConstantMemory", "size", matrixSizes, MatrixMultiplication::UseNonConstantMemory)
+                .add("MatrixMultiplication", "RowBlockRowMajorOrdering", "size", matrixSizes, MatrixMultiplication::RowBlockRowMajorOrdering)
+                .add("MatrixMultiplication", "MoreWork", "size", matrixSizes, MatrixMultiplication::MoreWork)
+                .add("MatrixMultiplicationCPU", "NaiveCPU", "size", matrixSizes, MatrixMultiplication::NaiveCPU, true)
+                .add("MatrixMultiplicationCPU", "TransposedCPU", "size", matrixSizes, MatrixMultiplication::TransposedCPU, true)
+                .add("Convolution", "Naive", "pixel", { 4096 }, Convolution::Naive)
+                .add("Convolution", "LoopUnroll", "pixel", { 8192 }, Convolution::LoopUnroll, true)
+                .add("Convolution", "GroupedConv", "pixel", { 4096 }, Convolution::GroupedConv)
+                .add("Pipeline", "UploadComputeDownload", "bytes", { 1_mb, 4_mb, 16_mb, 64_mb }, Pipeline::UploadComputeDownload)
+                .add("SanityCheck", "PassingStruct", SanityCheck::PassingStruct, true)
+                .add("SanityCheck", "Transpose", SanityCheck::Transpose, true)
+                .add("SanityCheck", "Streams", SanityCheck::Streams, true)
+                .add("MemoryType", "UseHostPtr", MemoryType::UseHostPtr, true)
+                .add("MemoryType", "AllocHostPtr", MemoryType::AllocHostPtr, true)
+                .add("MemoryType", "AllocHostPtrWithUseHostPtr", MemoryType::AllocHostPtrWithUseHostPtr, true);
+            return registry;
+        }();
+        return registry;
+    }
+}
@@ -0,0 +1,44 @@
+#include "ThreadPool.h"
+
+ThreadPool::ThreadPool(size_t threadCount)
+{
+    if (threadCount == 0)
+        threadCount = defaultThreadCount();
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+        workers.emplace_back([this] { work(); });
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard lock{ mutex };
+        stopping = true;
+    }
+    hasTask.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+size_t ThreadPool::defaultThreadCount()
+{
+    auto const count = std::thread::hardware_concurrency();
+    return count == 0 ? 1 : count;
+}
+
+void ThreadPool::work()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock lock{ mutex };
+            hasTask.wait(lock, [this] { return stopping || !tasks.empty(); });
+            if (tasks.empty())  //stopping, and every task is done
+                return;
+            task = std::move(tasks.front());
+            tasks.pop();
+        }
+        task();
+    }
+}
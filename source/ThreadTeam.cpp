@@ -0,0 +1,113 @@
+#include "ThreadTeam.h"
+#include <algorithm>
+#include "Error.hpp"
+
+#ifdef _WIN32
+    #define NOMINMAX
+    #include "Windows.h"
+#elif defined __linux__ && !defined ANDROID
+    #include <pthread.h>
+    #include <sched.h>
+#endif
+
+/*pin [thread] to [core], false when not supported*/
+static bool Pin(std::thread& thread, size_t core)
+{
+#ifdef _WIN32
+    if (core >= sizeof(DWORD_PTR) * 8)
+        return false;
+    return SetThreadAffinityMask(thread.native_handle(), DWORD_PTR{ 1 } << core) != 0;
+#elif defined __linux__ && !defined ANDROID
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(core, &set);
+    return pthread_setaffinity_np(thread.native_handle(), sizeof(set), &set) == 0;
+#else
+    (void)thread;
+    (void)core;
+    return false;
+#endif
+}
+
+ThreadTeam::ThreadTeam(size_t threadCount, bool pin)
+{
+    if (threadCount == 0)
+        throw ValueError{};
+
+    auto const cores = std::max(1u, std::thread::hardware_concurrency());
+    pinned = pin;
+    workers.reserve(threadCount);
+    for (size_t i = 0; i < threadCount; ++i)
+    {
+        workers.emplace_back([this, i] { work(i); });
+        if (pin)
+            pinned = Pin(workers.back(), i % cores) && pinned;
+    }
+}
+
+ThreadTeam::~ThreadTeam()
+{
+    {
+        std::lock_guard lock{ mutex };
+        stopping = true;
+    }
+    started.notify_all();
+    for (auto& worker : workers)
+        worker.join();
+}
+
+void ThreadTeam::run(std::function<void(size_t)> const& func)
+{
+    std::unique_lock lock{ mutex };
+    task = &func;
+    running = workers.size();
+    error = nullptr;
+    ++generation;
+    started.notify_all();
+    finished.wait(lock, [this] { return running == 0; });
+    task = nullptr;
+    if (error)
+        std::rethrow_exception(error);
+}
+
+std::pair<size_t, size_t> ThreadTeam::split(size_t count, size_t index, size_t threads)
+{
+    auto const share = count / threads;
+    auto const extra = count % threads;     //the first [extra] threads take one more
+    auto const begin = index * share + std::min(index, extra);
+    return { begin, begin + share + (index < extra ? 1 : 0) };
+}
+
+void ThreadTeam::work(size_t index)
+{
+    size_t seen{};
+    while (true)
+    {
+        std::function<void(size_t)> const* func{};
+        {
+            std::unique_lock lock{ mutex };
+            started.wait(lock, [&] { return stopping || generation != seen; });
+            if (stopping)
+                return;
+            seen = generation;
+            func = task;
+        }
+
+        std::exception_ptr thrown;
+        try {
+            (*func)(index);
+        }
+        catch (...)
+        {
+            thrown = std::current_exception();
+        }
+
+        {
+            std::lock_guard lock{ mutex };
+            if (thrown && !error)
+                error = thrown;
+            if (--running == 0)
+                finished.notify_one();
+        }
+    }
+}
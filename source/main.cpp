@@ -1,13 +1,160 @@
 #include "IO.hpp"
 #include "GPU.h"
 #include "Test.hpp"
+#include "Registry.h"
+#include "Measure.h"
+#include "Report.h"
+#include "Error.hpp"
+#include "Numa.h"
+#include <algorithm>
+#include <optional>
+#include <string_view>
 
-int main()
+int main(int argc, char** argv)
 {
-    test::DataTransfer::DataTransfer();
-    test::Compilation::Compilation();
-    test::Benchmark::Reduction::Reduction();
-    test::Benchmark::Convolution::Convolution();
-    test::Benchmark::Convolution::Convolution();
-    std::cout << "\aFinished all testing!";
+    /*--device=<selector> overrides CLBENCH_DEVICE, --all-devices runs the whole suite on every matching device*/
+    auto selector = DeviceSelector::fromEnvironment();
+    Registry::Selection selection;
+    bool list{};
+    std::string baseline;       //compare the results against this file
+    std::string results;        //compare this file instead of running the benchmarks
+    double threshold = 0.05;
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string_view const arg{ argv[i] };
+        auto const valueOf = [arg](std::string_view option) { return std::string{ arg.substr(option.size()) }; };
+        auto const parseNode = [](std::string const& value)
+        {
+            auto const node = static_cast<size_t>(std::stoull(value));
+            auto const nodes = NumaNodes();
+            if (std::find(nodes.begin(), nodes.end(), node) == nodes.end())
+                throw ValueError{};
+            return node;
+        };
+        try {
+            if (arg.rfind("--device=", 0) == 0)
+                selector = DeviceSelector::parse(valueOf("--device="));
+            else if (arg == "--all-devices")
+                selector.all = true;
+            else if (arg == "--list-devices")
+            {
+                ListDevices();
+                return 0;
+            }
+            else if (arg.rfind("--filter=", 0) == 0)
+            {
+                /*an explicit filter also reaches the optional benchmarks*/
+                selection.filter = std::regex{ valueOf("--filter="), std::regex::icase };
+                selection.includeOptional = true;
+            }
+            else if (arg.rfind("--sizes=", 0) == 0)
+                selection.sizes = Registry::parseSizes(valueOf("--sizes="));
+            else if (arg.rfind("--repetitions=", 0) == 0)
+            {
+                /*a fixed number of samples instead of repeating until the confidence interval is reached*/
+                auto const repetitions = std::stoull(valueOf("--repetitions="));
+                if (repetitions == 0)
+                    throw ValueError{};
+                measureOptions.minSamples = measureOptions.maxSamples = repetitions;
+            }
+            else if (arg.rfind("--warmup=", 0) == 0)
+                measureOptions.warmup = std::stoull(valueOf("--warmup="));
+            else if (arg == "--list")
+                list = true;
+            else if (arg.rfind("--json=", 0) == 0)
+                reporter.openJsonLines(valueOf("--json="));
+            else if (arg.rfind("--csv=", 0) == 0)
+                reporter.openCsv(valueOf("--csv="));
+            else if (arg.rfind("--compare=", 0) == 0)
+                baseline = valueOf("--compare=");
+            else if (arg.rfind("--results=", 0) == 0)
+                results = valueOf("--results=");
+            else if (arg.rfind("--threshold=", 0) == 0)
+                threshold = std::stod(valueOf("--threshold=")) / 100;
+            else if (arg.rfind("--pages=", 0) == 0)
+                hostPageKind = ParsePageKind(valueOf("--pages="));
+            else if (arg.rfind("--numa-buffer=", 0) == 0)
+                numaPlacement.bufferNode = parseNode(valueOf("--numa-buffer="));
+            else if (arg.rfind("--numa-thread=", 0) == 0)
+                numaPlacement.threadNode = parseNode(valueOf("--numa-thread="));
+            else
+                std::cerr << "Unknown argument: " << arg << '\n';
+        }
+        catch (std::exception const&)
+        {
+            std::cerr << "Invalid argument: " << arg << '\n';
+            return 1;
+        }
+    }
+
+    if (list)
+    {
+        /*the sizes depend on the device, so list them for the first selected one*/
+        auto const selected = FindDevices(selector);
+        if (selected.empty())
+        {
+            std::cerr << "No OpenCL device matches the selection.\n";
+            return 1;
+        }
+        UseDevice(selected.front());
+        test::Benchmarks().list(std::cout, selection);
+        return 0;
+    }
+
+    /*regressions exit with 2, to tell them apart from the errors*/
+    auto const compare = [&](std::vector<Reporter::Record> const& current)
+    {
+        try {
+            return Reporter::printComparison(std::cout, Reporter::load(baseline), current, threshold) == 0 ? 0 : 2;
+        }
+        catch (std::exception const&)
+        {
+            std::cerr << "Can not load the baseline: " << baseline << '\n';
+            return 1;
+        }
+    };
+    if (!results.empty())
+    {
+        if (baseline.empty())
+        {
+            std::cerr << "--results needs a --compare=<baseline>\n";
+            return 1;
+        }
+        try {
+            return compare(Reporter::load(results));
+        }
+        catch (std::exception const&)
+        {
+            std::cerr << "Can not load the results: " << results << '\n';
+            return 1;
+        }
+    }
+
+    /*the submitting thread stays on the node for the whole run*/
+    std::optional<NodeAffinity> affinity;
+    if (numaPlacement.threadNode)
+    {
+        affinity.emplace(*numaPlacement.threadNode);
+        if (!affinity->isPinned())
+            std::cerr << "Can not pin the thread to NUMA node " << *numaPlacement.threadNode << '\n';
+    }
+
+    size_t benchmarks{};
+    auto const count = ForEachDevice(selector, [&]
+    {
+        benchmarks = test::Benchmarks().run(selection);
+    });
+    if (count == 0)
+    {
+        std::cerr << "No OpenCL device matches the selection.\n";
+        return 1;
+    }
+    if (benchmarks == 0)
+    {
+        std::cerr << "No benchmark matches the filter, see --list.\n";
+        return 1;
+    }
+    std::cout << "\aFinished all testing!\n";
+    if (!baseline.empty())
+        return compare(reporter.getRecords());
 }